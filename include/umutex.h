@@ -0,0 +1,43 @@
+#ifndef _UMUTEX_H_
+#define _UMUTEX_H_
+
+/*
+ * User-level mutexes and condition variables.
+ *
+ * These live entirely in user memory. Locking a free mutex, unlocking
+ * one nobody is waiting for, and signalling a condition variable with
+ * no waiters are done with atomic instructions alone; only when a thread
+ * really has to wait (or wake somebody) is futex_wait or futex_wake
+ * called.
+ *
+ * Both may be statically initialized with the _INITIALIZER macros, or
+ * at run time with umutex_init/ucond_init. Neither needs destroying.
+ *
+ * ucond_wait must be called with the mutex held; it is released while
+ * waiting and held again on return. Wakeups may be spurious, so the
+ * condition should always be rechecked in a loop.
+ */
+
+struct umutex {
+	volatile int um_state;  /* 0 free, 1 locked, 2 locked with waiters */
+};
+
+struct ucond {
+	volatile int uc_seq;    /* bumped by every signal and broadcast */
+	volatile int uc_waiters;  /* threads in ucond_wait */
+};
+
+#define UMUTEX_INITIALIZER  { 0 }
+#define UCOND_INITIALIZER   { 0, 0 }
+
+void umutex_init(struct umutex *m);
+void umutex_lock(struct umutex *m);
+int  umutex_trylock(struct umutex *m);  /* 1 if we got it, 0 if not */
+void umutex_unlock(struct umutex *m);
+
+void ucond_init(struct ucond *c);
+void ucond_wait(struct ucond *c, struct umutex *m);
+void ucond_signal(struct ucond *c);
+void ucond_broadcast(struct ucond *c);
+
+#endif /* _UMUTEX_H_ */
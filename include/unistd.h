@@ -123,6 +123,21 @@ int __getcwd(char *buf, size_t buflen);
 /* stat - see sys/stat.h */
 /* lstat - see sys/stat.h */
 
+/*
+ * Futexes, for building user-level locks (see umutex.h). futex_wait
+ * sleeps only if *uaddr still equals expected, failing with EAGAIN
+ * otherwise; futex_wake wakes up to n sleepers and returns how many.
+ */
+int futex_wait(volatile int *uaddr, int expected);
+int futex_wake(volatile int *uaddr, int n);
+
+/*
+ * Start a new process running the program path with arguments argv,
+ * like fork() followed by execv() in the child but without copying the
+ * caller first. Returns the child's pid.
+ */
+pid_t spawn(const char *path, char *const *argv);
+
 /*
  * These are not themselves system calls, but wrapper routines in libc.
  */
@@ -0,0 +1,139 @@
+/*
+ * Atomic operations: machine-dependent part. Use <atomic.h>, not this.
+ *
+ * Built on the MIPS load-linked/store-conditional pair. ll/sc are MIPS II
+ * instructions; System/161 implements them even though the rest of the
+ * processor is MIPS I, so the assembler is told to allow them here.
+ */
+
+#ifndef _MACHINE_ATOMIC_H_
+#define _MACHINE_ATOMIC_H_
+
+/*
+ * Memory barrier: loads and stores before it complete before any after
+ * it. Also stops the compiler moving memory accesses across it.
+ */
+static __inline
+void
+membar(void)
+{
+	__asm volatile(
+		".set push;"
+		".set mips2;"
+		"sync;"
+		".set pop"
+		: : : "memory");
+}
+
+/*
+ * Compare and swap: if *P equals OLD, store NEW there, all in one
+ * atomic step. Returns the value *P had beforehand, so the swap took
+ * place if and only if that equals OLD.
+ */
+static __inline
+u_int32_t
+atomic_cas_32(volatile u_int32_t *p, u_int32_t old, u_int32_t new)
+{
+	u_int32_t prev, tmp;
+
+	__asm volatile(
+		".set push;"
+		".set mips2;"
+		".set noreorder;"
+		"1: ll %0, 0(%2);"	/* prev = *p, and watch *p */
+		"bne %0, %3, 2f;"	/* not what we expected; give up */
+		"move %1, %4;"		/* (delay slot) */
+		"sc %1, 0(%2);"		/* *p = new, unless *p was touched */
+		"beqz %1, 1b;"		/* it was; start over */
+		"nop;"
+		"sync;"
+		"2: .set pop"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (old), "r" (new)
+		: "memory");
+
+	return prev;
+}
+
+/*
+ * Swap: store NEW in *P and return what was there before, atomically.
+ */
+static __inline
+u_int32_t
+atomic_swap_32(volatile u_int32_t *p, u_int32_t new)
+{
+	u_int32_t prev, tmp;
+
+	__asm volatile(
+		".set push;"
+		".set mips2;"
+		".set noreorder;"
+		"1: ll %0, 0(%2);"	/* prev = *p, and watch *p */
+		"move %1, %3;"
+		"sc %1, 0(%2);"		/* *p = new, unless *p was touched */
+		"beqz %1, 1b;"		/* it was; start over */
+		"nop;"
+		"sync;"
+		".set pop"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (new)
+		: "memory");
+
+	return prev;
+}
+
+/*
+ * Add DELTA to *P, atomically. Returns the new value.
+ */
+static __inline
+u_int32_t
+atomic_add_32(volatile u_int32_t *p, u_int32_t delta)
+{
+	u_int32_t prev, tmp;
+
+	__asm volatile(
+		".set push;"
+		".set mips2;"
+		".set noreorder;"
+		"1: ll %0, 0(%2);"
+		"addu %1, %0, %3;"
+		"sc %1, 0(%2);"
+		"beqz %1, 1b;"
+		"nop;"
+		"sync;"
+		".set pop"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (delta)
+		: "memory");
+
+	return prev + delta;
+}
+
+/*
+ * OR BITS into *P, atomically. Returns the value *P had beforehand.
+ */
+static __inline
+u_int32_t
+atomic_fetch_or_32(volatile u_int32_t *p, u_int32_t bits)
+{
+	u_int32_t prev, tmp;
+
+	__asm volatile(
+		".set push;"
+		".set mips2;"
+		".set noreorder;"
+		"1: ll %0, 0(%2);"
+		"or %1, %0, %3;"
+		"sc %1, 0(%2);"
+		"beqz %1, 1b;"
+		"nop;"
+		"sync;"
+		".set pop"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (bits)
+		: "memory");
+
+	return prev;
+}
+
+#endif /* _MACHINE_ATOMIC_H_ */
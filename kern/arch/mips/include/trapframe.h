@@ -75,7 +75,22 @@ struct trapframe {
  */
 void mips_usermode(struct trapframe *tf);
 #if OPT_A2
-void md_forkentry(void *t, unsigned long unused_param);
+struct addrspace;
+struct process;
+
+/*
+ * What sys_fork() hands the child: copies of the parent's trapframe and
+ * address space, made before the parent returns, and the child's own
+ * process. md_forkentry() takes ownership and frees the structure, so
+ * the child never looks at the parent.
+ */
+struct fork_args {
+	struct trapframe fa_tf;
+	struct addrspace *fa_as;
+	struct process *fa_child;
+};
+
+void md_forkentry(void *args, unsigned long unused);
 #else // OPT_A2
 void md_forkentry(struct trapframe *tf);
 #endif
@@ -12,6 +12,7 @@
 #if OPT_A2
 #include <addrspace.h>
 #include <thread.h>
+#include <curthread.h>
 #include <proc.h>
 
 extern struct process *curproc;
@@ -86,8 +87,8 @@ mips_syscall(struct trapframe *tf)
 
 #if OPT_A2
         case SYS__exit:
-            kprintf("Call to _exit()\n");
-            err = ENOSYS;
+            sys__exit(tf->tf_a0);
+            panic("sys__exit returned\n");
             break;
 
         case SYS_execv:
@@ -96,31 +97,11 @@ mips_syscall(struct trapframe *tf)
             break;
 
         case SYS_fork:
-            retval = sys_fork(tf);
-
-            // Map sys_fork error to a proper errno
-            switch (retval) {
-                case -1:
-                    err = EAGAIN;
-                    break;
-                case -2:
-                    err = ENOMEM;
-                    break;
-                /*
-                 * If sys_fork() returned a value other than -1 or -2,
-                 * then it should have been sucessful and returned
-                 * either 0 or a proper pid.
-                 */
-                default:
-                    err = 0;
-                    break;
-            }
-
+            err = sys_fork(tf, &retval);
             break;
 
         case SYS_waitpid:
-            kprintf("Call to waitpid()\n");
-            err = ENOSYS;
+            err = sys_waitpid(tf->tf_a0, (userptr_t)tf->tf_a1, tf->tf_a2, &retval);
             break;
 
         case SYS_open:
@@ -147,6 +128,22 @@ mips_syscall(struct trapframe *tf)
             kprintf("Call to getpid()\n");
             err = ENOSYS;
             break;
+
+        case SYS_futex_wait:
+            err = sys_futex_wait((userptr_t)tf->tf_a0, tf->tf_a1);
+            break;
+
+        case SYS_futex_wake:
+            err = sys_futex_wake((userptr_t)tf->tf_a0, tf->tf_a1, &retval);
+            break;
+
+        case SYS_spawn:
+            err = sys_spawn((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1, &retval);
+            break;
+
+        case SYS___time:
+            err = sys___time((userptr_t)tf->tf_a0, (userptr_t)tf->tf_a1, &retval);
+            break;
 #else // OPT_A2
 	    /* Add stuff here */
 #endif
@@ -186,32 +183,38 @@ mips_syscall(struct trapframe *tf)
 
 #if OPT_A2
 void
-md_forkentry(void *t, unsigned long unused_param)
+md_forkentry(void *args, unsigned long unused)
 {
-    int err;
-    struct trapframe *tf = (struct trapframe *)t;
-    struct process *parent = process_getparent();
-    (void)unused_param;
-
-    // Copy the address space of the parent. May return ENOMEM.
-    struct addrspace **new_vmspace = &curproc->p_thread->t_vmspace;
-    err = as_copy(parent->p_thread->t_vmspace, new_vmspace);
-    if (err == ENOMEM) {
-        // Not sure what to do here. Should be telling parent that something bad happened?
-    }
+    struct fork_args *fa = (struct fork_args *)args;
+    struct process *me = fa->fa_child;
+    struct trapframe tf;
+
+    (void)unused;
+
+    // We were born into the parent's process; move into our own
+    process_enter(me);
+
+    // sys_fork() already copied the parent's address space for us
+    assert(curthread->t_vmspace == NULL);
+    curthread->t_vmspace = fa->fa_as;
+    as_activate(curthread->t_vmspace);
 
     /*
-     * As in common_exception(), move curkstack back and copy in
-     * the trapframe. However, move back 148 bytes instead of 164
-     * since this time, we don't have a arguments to pass.
+     * mips_usermode() wants the trapframe on our own kernel stack, so
+     * take it out of the heap copy, which we're now done with.
      */
-    struct trapframe *my_tf = (struct trapframe *)curkstack-148;
-    memcpy(my_tf, tf, sizeof(struct trapframe));
+    memcpy(&tf, &fa->fa_tf, sizeof(struct trapframe));
+    kfree(fa);
+
+    // fork() returns 0 in the child, and carries on after the syscall
+    tf.tf_v0 = 0;
+    tf.tf_a3 = 0;
+    tf.tf_epc += 4;
 
     // Enter mips_usermode, as if we just returned from mips_trap()
-    mips_usermode(my_tf);
+    mips_usermode(&tf);
 
-    // Hopefully never get here
+    panic("md_forkentry: mips_usermode returned\n");
 }
 #else // OPT_A2
 void
@@ -22,6 +22,7 @@
 #include <synch.h>
 
 #if OPT_A1
+#include <queue.h>
 #include "kitchen.h"
 #endif // OPT_A1
 
@@ -68,12 +69,14 @@ int NumCats;   // number of cats
 int NumMice;   // number of mice
 int NumLoops;  // number of times each cat and mouse should eat
 
+#if !OPT_A1
 /*
  * Once the main driver function (catmouse()) has created the cat and mouse
  * simulation threads, it uses this semaphore to block until all of the
  * cat and mouse simulations are finished.
  */
 struct semaphore *CatMouseWait;
+#endif // OPT_A1
 
 /*
  * 
@@ -299,6 +302,11 @@ void eat(const int creature_type) {
 void kitchen_destroy(struct kitchen *k) {
     int i;
 
+    // Report how much work the lock handoff saved on the entrance lock
+    kprintf("catmouse: %s lock: %u handoffs, %u spurious wakeups avoided\n",
+            k->kitchen_lock->name, k->kitchen_lock->handoffs,
+            k->kitchen_lock->wakeups_saved);
+
     // Destroy the queue elements
     while (!q_empty(k->group_list)) {
         kfree(q_remhead(k->group_list));
@@ -391,8 +399,10 @@ cat_simulation(void * unusedpointer,
 
   }
 
+#if !OPT_A1
   /* indicate that this cat simulation is finished */
   V(CatMouseWait); 
+#endif // OPT_A1
 }
 	
 /*
@@ -457,8 +467,10 @@ mouse_simulation(void * unusedpointer,
 
   }
 
+#if !OPT_A1
   /* indicate that this mouse is finished */
   V(CatMouseWait); 
+#endif // OPT_A1
 }
 
 
@@ -494,6 +506,9 @@ catmouse(int nargs,
 {
   int index, error;
   int i;
+#if OPT_A1
+  struct thread **creatures;
+#endif // OPT_A1
 
   /* check and process command line arguments */
   if (nargs != 5) {
@@ -525,12 +540,21 @@ catmouse(int nargs,
   kprintf("Using %d bowls, %d cats, and %d mice. Looping %d times.\n",
           NumBowls,NumCats,NumMice,NumLoops);
 
+#if OPT_A1
+  /* the cats and mice are joinable; keep their handles so the main
+     thread can join each of them once they have finished */
+  creatures = kmalloc((NumCats+NumMice+1) * sizeof(struct thread *));
+  if (creatures == NULL) {
+    panic("catmouse: could not allocate thread handles\n");
+  }
+#else
   /* create the semaphore that is used to make the main thread
      wait for all of the cats and mice to finish */
   CatMouseWait = sem_create("CatMouseWait",0);
   if (CatMouseWait == NULL) {
     panic("catmouse: could not create semaphore\n");
   }
+#endif // OPT_A1
 
   /* 
    * initialize the bowls
@@ -544,6 +568,23 @@ catmouse(int nargs,
   k = kitchen_create();
 #endif
 
+#if OPT_A1
+  /*
+   * Start NumCats cat_simulation() threads, then NumMice
+   * mouse_simulation() threads, each group as a single batch.
+   */
+  error = thread_fork_many("cat_simulation thread",NumCats,NULL,cat_simulation,
+                           1,creatures);
+  if (error) {
+    panic("cat_simulation: thread_fork_many failed: %s\n", strerror(error));
+  }
+  error = thread_fork_many("mouse_simulation thread",NumMice,NULL,mouse_simulation,
+                           1,creatures+NumCats);
+  if (error) {
+    panic("mouse_simulation: thread_fork_many failed: %s\n", strerror(error));
+  }
+  (void)index;
+#else
   /*
    * Start NumCats cat_simulation() threads.
    */
@@ -564,19 +605,30 @@ catmouse(int nargs,
     }
   }
 
+#endif // OPT_A1
+
   /* wait for all of the cats and mice to finish before
      terminating */  
+#if OPT_A1
+  for(i=0;i<(NumCats+NumMice);i++) {
+    thread_join(creatures[i], NULL);
+  }
+  kfree(creatures);
+#else
   for(i=0;i<(NumCats+NumMice);i++) {
     P(CatMouseWait);
   }
+#endif // OPT_A1
 
 #if OPT_A1
   // Cleanup the kitchen lol
   kitchen_destroy(k);
 #endif
 
+#if !OPT_A1
   /* clean up the semaphore the we created */
   sem_destroy(CatMouseWait);
+#endif // OPT_A1
 
   return 0;
 }
@@ -0,0 +1,272 @@
+/*
+ * pitest.c
+ *
+ * Priority inversion test for the lock priority inheritance done under
+ * OPT_MLFQ (see synch.h).
+ *
+ * A low priority thread, one that has used enough CPU to sink to the
+ * bottom MLFQ level, takes a lock. Then some medium priority threads
+ * start keeping the CPU busy: each runs for part of a tick and sleeps
+ * until the next, which keeps them near the top level. Finally a fresh,
+ * top level thread asks for the lock. Without inheritance the low
+ * thread doesn't get the CPU back to release the lock until the next
+ * priority boost; with it, it runs at the high thread's priority and
+ * the wait is a few ticks.
+ *
+ * The periodic boost is held off for the whole test, so it can't rescue
+ * the low thread and make a missing inheritance look like a pass. The
+ * scenario is run twice: once as it is, which must finish within the
+ * bound, and once with inheritance turned off as a control, which must
+ * not (there the high thread gives up waiting after a while).
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <test.h>
+#include <thread.h>
+#include <synch.h>
+#include <timeout.h>
+#include <scheduler.h>
+#include <ktest.h>
+
+#include "opt-A1.h"
+#include "opt-mlfq.h"
+
+#if OPT_A1
+#if OPT_MLFQ
+
+/* Ticks of CPU the low thread burns to sink to the bottom level */
+#define PITEST_SINK   16
+
+/* Ticks of CPU it then holds the lock for */
+#define PITEST_HOLD   4
+
+/* Number of medium priority CPU hogs */
+#define PITEST_NMED   4
+
+/* Longest the high thread may wait for the lock, in ticks */
+#define PITEST_BOUND  (HZ/5)
+
+/* When the high thread stops waiting for it, in ticks */
+#define PITEST_GIVEUP (4*PITEST_BOUND)
+
+static struct lock *pi_lock;
+static struct semaphore *pi_held;   /* low thread has the lock */
+static volatile int pi_done;        /* medium threads should stop */
+static int pi_blocked;              /* high thread had to wait */
+static u_int32_t pi_waited;         /* ... for this many ticks */
+static int pi_gaveup;               /* ... and then gave up */
+static unsigned pi_loops;           /* pi_spin loops per tick */
+
+/*
+ * Burn CPU for LOOPS iterations. This is counted in iterations, not
+ * clock ticks, so time spent preempted doesn't count.
+ */
+static
+void
+pi_spin(unsigned loops)
+{
+	volatile unsigned i;
+
+	for (i=0; i<loops; i++) {
+		(void)clock_ticks();
+	}
+}
+
+/*
+ * Count how many pi_spin iterations fit in one clock tick.
+ */
+static
+void
+pi_calibrate(void)
+{
+	volatile unsigned i;
+	u_int32_t start;
+
+	/* Start on a tick boundary */
+	start = clock_ticks();
+	while (clock_ticks() == start) {
+		/* nothing */
+	}
+
+	start = clock_ticks();
+	for (i=0; clock_ticks() == start; i++) {
+		/* nothing */
+	}
+	pi_loops = i;
+}
+
+static
+void
+pi_low(void *unused, unsigned long junk)
+{
+	(void)unused;
+	(void)junk;
+
+	pi_spin(PITEST_SINK * pi_loops);
+
+	lock_acquire(pi_lock);
+	V(pi_held);
+	pi_spin(PITEST_HOLD * pi_loops);
+	lock_release(pi_lock);
+}
+
+static
+void
+pi_medium(void *unused, unsigned long num)
+{
+	(void)unused;
+	(void)num;
+
+	while (!pi_done) {
+		pi_spin(pi_loops / 2);
+		thread_sleep_until(clock_ticks() + 1);
+	}
+}
+
+static
+void
+pi_high(void *unused, unsigned long junk)
+{
+	u_int32_t start;
+
+	(void)unused;
+	(void)junk;
+
+	start = clock_ticks();
+	pi_blocked = !lock_tryacquire(pi_lock);
+	pi_gaveup = 0;
+	if (pi_blocked) {
+		pi_gaveup = lock_acquire_timeout(pi_lock, PITEST_GIVEUP) != 0;
+	}
+	pi_waited = clock_ticks() - start;
+	if (!pi_gaveup) {
+		lock_release(pi_lock);
+	}
+}
+
+/*
+ * Run the scenario once, with priority inheritance on or off. Returns
+ * 0 if it ran, leaving the high thread's wait in pi_waited and
+ * pi_gaveup, or nonzero if the low thread let go of the lock too soon.
+ */
+static
+int
+pi_run(int inherit)
+{
+	struct thread *low, *high, *med[PITEST_NMED];
+	int error, i;
+
+	lock_setinherit(inherit);
+
+	pi_lock = lock_create("pitest");
+	pi_held = sem_create("pitest held", 0);
+	if (pi_lock == NULL || pi_held == NULL) {
+		panic("pitest: out of memory\n");
+	}
+	pi_done = 0;
+	pi_calibrate();
+
+	error = thread_fork_joinable("pitest low", NULL, 0, pi_low, &low);
+	if (error) {
+		panic("pitest: thread_fork_joinable failed: %s\n",
+		      strerror(error));
+	}
+	P(pi_held);
+
+	error = thread_fork_many("pitest medium", PITEST_NMED, NULL,
+				 pi_medium, 1, med);
+	if (error) {
+		panic("pitest: thread_fork_many failed: %s\n",
+		      strerror(error));
+	}
+
+	error = thread_fork_joinable("pitest high", NULL, 0, pi_high, &high);
+	if (error) {
+		panic("pitest: thread_fork_joinable failed: %s\n",
+		      strerror(error));
+	}
+
+	thread_join(high, NULL);
+	pi_done = 1;
+	for (i=0; i<PITEST_NMED; i++) {
+		thread_join(med[i], NULL);
+	}
+	thread_join(low, NULL);
+
+	sem_destroy(pi_held);
+	lock_destroy(pi_lock);
+
+	if (!pi_blocked) {
+		kprintf("pitest: the low thread let go of the lock before "
+			"the high thread asked; try again\n");
+		return 1;
+	}
+	kprintf("pitest: inheritance %s: high priority thread %s after %u "
+		"ticks (limit %d)\n", inherit ? "on" : "off",
+		pi_gaveup ? "gave up" : "got the lock", pi_waited,
+		PITEST_BOUND);
+	return 0;
+}
+
+int
+pitest(int nargs, char **args)
+{
+	int boost, inherit, bad = 0;
+
+	(void)args;
+	if (nargs != 1) {
+		kprintf("Usage: pitest\n");
+		return 1;
+	}
+
+	boost = scheduler_setboost(0);
+	inherit = lock_setinherit(1);
+
+	if (pi_run(1)) {
+		bad = 1;
+	}
+	else if (pi_gaveup || pi_waited > PITEST_BOUND) {
+		kprintf("pitest: with inheritance, the wait went over the "
+			"limit\n");
+		bad = 1;
+	}
+
+	// Control: without inheritance the same setup should blow the limit
+	if (!bad) {
+		if (pi_run(0)) {
+			bad = 1;
+		}
+		else if (!pi_gaveup && pi_waited <= PITEST_BOUND) {
+			kprintf("pitest: without inheritance, the wait was "
+				"within the limit too, so it proves nothing\n");
+			bad = 1;
+		}
+	}
+
+	lock_setinherit(inherit);
+	scheduler_setboost(boost);
+
+	if (bad) {
+		kprintf("pitest: FAILED\n");
+		return 1;
+	}
+	kprintf("pitest: passed\n");
+	return 0;
+}
+
+#else
+
+int
+pitest(int nargs, char **args)
+{
+	(void)nargs;
+	(void)args;
+
+	kprintf("pitest: needs options mlfq\n");
+	return 1;
+}
+
+#endif // OPT_MLFQ
+#endif // OPT_A1
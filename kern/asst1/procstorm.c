@@ -0,0 +1,278 @@
+/*
+ * procstorm.c
+ *
+ * Process table tests and benchmarks. These are kernel menu commands
+ * (see ktest.h), so they run in the kernel's own process, pid 0, and
+ * the processes they make are its children. They only ever wait for
+ * the pids they forked themselves, so they leave alone any other
+ * children pid 0 has, such as user programs started from the menu.
+ *
+ * The children are kernel threads. Each moves into its new process
+ * with process_enter() and calls sys__exit() straight away, which is
+ * all the process table ever sees of a user program that is forked
+ * and exits.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <test.h>
+#include <thread.h>
+#include <clock.h>
+#include <proc.h>
+#include <syscall.h>
+#include <ktest.h>
+
+#include "opt-A2.h"
+
+#if OPT_A2
+
+static
+void
+ps_child(void *unused, unsigned long child)
+{
+	(void)unused;
+
+	process_enter((struct process *)child);
+	sys__exit(0);
+}
+
+/*
+ * Start a child process that exits at once, and put its pid in *PIDP.
+ * Returns an error code.
+ */
+static
+int
+ps_fork(pid_t *pidp)
+{
+	struct process *child;
+	int err;
+
+	err = process_create(&child);
+	if (err) {
+		return err;
+	}
+	// Now, since the child may be gone by the time thread_fork returns
+	*pidp = child->p_id;
+	err = thread_fork("procstorm child", NULL, (unsigned long)child,
+			  ps_child, NULL);
+	if (err) {
+		process_undo(child);
+	}
+	return err;
+}
+
+////////////////////////////////////////////////////////////
+//
+// procstorm NPROCS [ROUNDS]
+//
+// Fork NPROCS * ROUNDS (default 10 rounds) children that exit at once,
+// never letting more than NPROCS be outstanding: once there are that
+// many, collect the oldest with waitpid() before forking the next.
+// Prints the most processes and zombies there were at once, and fails
+// unless the live and zombie counts are back where they started at the
+// end.
+
+int
+procstorm(int nargs, char **args)
+{
+	u_int32_t nprocs0, nzombies0, nprocs, nzombies;
+	u_int32_t peakprocs, peakzombies;
+	int n, rounds, total, forks, outstanding, err;
+	pid_t *pids, pid;
+
+	if (nargs != 2 && nargs != 3) {
+		kprintf("Usage: procstorm NPROCS [ROUNDS]\n");
+		return 1;
+	}
+	n = atoi(args[1]);
+	rounds = nargs == 3 ? atoi(args[2]) : 10;
+	if (n <= 0 || rounds <= 0) {
+		kprintf("procstorm: invalid arguments\n");
+		return 1;
+	}
+
+	// Outstanding children, oldest at pids[forks % n] once there are n
+	pids = kmalloc(n * sizeof(pid_t));
+	if (pids == NULL) {
+		panic("procstorm: out of memory\n");
+	}
+
+	process_getcounts(&nprocs0, &nzombies0);
+	peakprocs = nprocs0;
+	peakzombies = nzombies0;
+
+	total = n * rounds;
+	outstanding = 0;
+	err = 0;
+	for (forks=0; forks<total; forks++) {
+		if (outstanding == n) {
+			err = sys_waitpid(pids[forks % n], NULL, 0, &pid);
+			if (err) {
+				kprintf("procstorm: waitpid: %s\n",
+					strerror(err));
+				break;
+			}
+			outstanding--;
+		}
+
+		err = ps_fork(&pids[forks % n]);
+		if (err) {
+			kprintf("procstorm: fork: %s\n", strerror(err));
+			break;
+		}
+		outstanding++;
+
+		process_getcounts(&nprocs, &nzombies);
+		if (nprocs > peakprocs) {
+			peakprocs = nprocs;
+		}
+		if (nzombies > peakzombies) {
+			peakzombies = nzombies;
+		}
+	}
+
+	// Collect the rest
+	while (outstanding > 0) {
+		if (sys_waitpid(pids[(forks - outstanding) % n], NULL, 0,
+				&pid)) {
+			break;
+		}
+		outstanding--;
+	}
+	process_getcounts(&nprocs, &nzombies);
+	kfree(pids);
+
+	kprintf("procstorm: %d forks, at most %u processes and %u zombies "
+		"at once\n", forks, peakprocs, peakzombies);
+	kprintf("procstorm: %u processes (%u zombies) before, "
+		"%u (%u) after\n", nprocs0, nzombies0, nprocs, nzombies);
+	if (err || outstanding != 0 ||
+	    nprocs != nprocs0 || nzombies != nzombies0) {
+		kprintf("procstorm: FAILED\n");
+		return 1;
+	}
+	kprintf("procstorm: passed\n");
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// pidbench [FORKS]
+//
+// Time fork, _exit and waitpid for one child at a time, FORKS times
+// (default 1000): first with the process table as it is, then with 90%
+// of all pids held by zombies, where a pid allocator that searches the
+// table for a free slot slows right down. The zombies are children
+// nobody has waited for yet; the process limit is raised to PROC_PIDMAX
+// while they exist, and they are all collected at the end.
+
+#define PB_PERCENT 90
+
+/*
+ * Fork, and wait for, N children one at a time. Returns the time it
+ * took in microseconds, or 0 if something failed.
+ */
+static
+u_int32_t
+pb_churn(int n)
+{
+	time_t secs;
+	u_int32_t nsecs;
+	pid_t pid, ret;
+	int i, err;
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<n; i++) {
+		err = ps_fork(&pid);
+		if (err == 0) {
+			err = sys_waitpid(pid, NULL, 0, &ret);
+		}
+		if (err) {
+			kprintf("pidbench: fork %d: %s\n", i, strerror(err));
+			return 0;
+		}
+	}
+	return ktest_usecs(secs, nsecs);
+}
+
+static
+void
+pb_print(u_int32_t nprocs, u_int32_t usecs, int n)
+{
+	kprintf("pidbench: %u of %u pids in use: %d forks in %u us, "
+		"%u.%03u us each\n", nprocs, PROC_PIDMAX, n, usecs,
+		usecs / n, (usecs % n) * 1000 / n);
+}
+
+int
+pidbench(int nargs, char **args)
+{
+	u_int32_t limit, nprocs, nzombies, target, usecs;
+	int n, zombies, failed, err;
+	pid_t *pids, pid;
+
+	if (nargs > 2) {
+		kprintf("Usage: pidbench [FORKS]\n");
+		return 1;
+	}
+	n = nargs == 2 ? atoi(args[1]) : 1000;
+	if (n <= 0) {
+		kprintf("pidbench: invalid number of forks\n");
+		return 1;
+	}
+
+	process_getcounts(&nprocs, &nzombies);
+	usecs = pb_churn(n);
+	if (usecs == 0) {
+		return 1;
+	}
+	pb_print(nprocs, usecs, n);
+
+	limit = process_getlimit();
+	process_setlimit(PROC_PIDMAX);
+
+	// Fill the table. Let each child run and exit before the next one,
+	// so only zombies pile up and not thread stacks.
+	target = PROC_PIDMAX * PB_PERCENT / 100;
+	pids = kmalloc(target * sizeof(pid_t));
+	if (pids == NULL) {
+		panic("pidbench: out of memory\n");
+	}
+	zombies = 0;
+	failed = 0;
+	while (nprocs < target) {
+		err = ps_fork(&pids[zombies]);
+		if (err) {
+			kprintf("pidbench: stopped filling the table at %u "
+				"processes: %s\n", nprocs, strerror(err));
+			failed = 1;
+			break;
+		}
+		zombies++;
+		thread_yield();
+		process_getcounts(&nprocs, &nzombies);
+	}
+
+	if (!failed) {
+		usecs = pb_churn(n);
+		if (usecs == 0) {
+			failed = 1;
+		}
+		else {
+			pb_print(nprocs, usecs, n);
+		}
+	}
+
+	process_setlimit(limit);
+	while (zombies > 0) {
+		if (sys_waitpid(pids[--zombies], NULL, 0, &pid)) {
+			failed = 1;
+			break;
+		}
+	}
+	kfree(pids);
+	return failed;
+}
+
+#endif // OPT_A2
@@ -0,0 +1,146 @@
+/*
+ * sharetest.c
+ *
+ * Proportional share test for the stride scheduler ("options stride";
+ * see scheduler.h). CPU-bound threads are given tickets in the ratio
+ * 1:2:4 and left to compete for a while. The ticks each one actually
+ * ran, from scheduler_getshare(), must split the same way.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <test.h>
+#include <thread.h>
+#include <timeout.h>
+#include <scheduler.h>
+#include <ktest.h>
+
+#include "opt-A1.h"
+#include "opt-stride.h"
+
+#if OPT_A1
+#if OPT_STRIDE
+
+#define ST_NTHREADS   3
+
+/* Tickets of each thread */
+static const unsigned st_tickets[ST_NTHREADS] = { 100, 200, 400 };
+
+/* Most a thread's share may be off by, in tenths of a percent */
+#define ST_TOLERANCE  20
+
+static volatile int st_stop;
+
+static
+void
+st_hog(void *unused, unsigned long num)
+{
+	(void)unused;
+	(void)num;
+
+	while (!st_stop) {
+		/* nothing */
+	}
+}
+
+////////////////////////////////////////////////////////////
+//
+// sharetest [SECONDS]
+//
+// Run the threads for SECONDS (default 5) while the menu thread sleeps,
+// then compare each thread's share of the ticks they ran between them
+// with its share of the tickets.
+
+int
+sharetest(int nargs, char **args)
+{
+	struct thread *threads[ST_NTHREADS];
+	unsigned start[ST_NTHREADS], ran[ST_NTHREADS];
+	unsigned ticks, total, alltickets, allran, got, want;
+	int secs, error, i, bad = 0;
+
+	if (nargs > 2) {
+		kprintf("Usage: sharetest [SECONDS]\n");
+		return 1;
+	}
+	secs = nargs == 2 ? atoi(args[1]) : 5;
+	if (secs <= 0) {
+		kprintf("sharetest: invalid number of seconds\n");
+		return 1;
+	}
+
+	st_stop = 0;
+	error = thread_fork_many("sharetest", ST_NTHREADS, NULL, st_hog, 1,
+				 threads);
+	if (error) {
+		panic("sharetest: thread_fork_many failed: %s\n",
+		      strerror(error));
+	}
+
+	alltickets = 0;
+	for (i=0; i<ST_NTHREADS; i++) {
+		error = scheduler_settickets(threads[i], st_tickets[i]);
+		assert(error == 0);
+		alltickets += st_tickets[i];
+	}
+
+	// Count only what they run from here on, with the new tickets
+	for (i=0; i<ST_NTHREADS; i++) {
+		scheduler_getshare(threads[i], &start[i], &total);
+	}
+	thread_sleep_until(clock_ticks() + secs * HZ);
+
+	allran = 0;
+	for (i=0; i<ST_NTHREADS; i++) {
+		scheduler_getshare(threads[i], &ticks, &total);
+		ran[i] = ticks - start[i];
+		allran += ran[i];
+	}
+
+	st_stop = 1;
+	for (i=0; i<ST_NTHREADS; i++) {
+		thread_join(threads[i], NULL);
+	}
+
+	if (allran == 0) {
+		kprintf("sharetest: the threads never ran\n");
+		kprintf("sharetest: FAILED\n");
+		return 1;
+	}
+
+	// Shares in tenths of a percent
+	for (i=0; i<ST_NTHREADS; i++) {
+		got = ran[i] * 1000 / allran;
+		want = st_tickets[i] * 1000 / alltickets;
+		kprintf("sharetest: %u tickets: ran %u of %u ticks, "
+			"%u.%u%% (expected %u.%u%%)\n", st_tickets[i],
+			ran[i], allran, got / 10, got % 10, want / 10,
+			want % 10);
+		if (got + ST_TOLERANCE < want || got > want + ST_TOLERANCE) {
+			bad = 1;
+		}
+	}
+
+	if (bad) {
+		kprintf("sharetest: FAILED\n");
+		return 1;
+	}
+	kprintf("sharetest: passed\n");
+	return 0;
+}
+
+#else
+
+int
+sharetest(int nargs, char **args)
+{
+	(void)nargs;
+	(void)args;
+
+	kprintf("sharetest: needs options stride\n");
+	return 1;
+}
+
+#endif // OPT_STRIDE
+#endif // OPT_A1
@@ -19,6 +19,8 @@
 #include <test.h>
 #include <thread.h>
 
+#include "opt-A1.h"
+
 
 /*
  *
@@ -210,6 +212,28 @@ createcars(int nargs,
          * Start NCARS approachintersection() threads.
          */
 
+#if OPT_A1
+        /*
+         * Fork all the cars as one batch; car i gets carnumber i.
+         */
+
+        error = thread_fork_many("approachintersection thread",
+                                 NCARS,
+                                 NULL,
+                                 approachintersection,
+                                 0,
+                                 NULL
+                                 );
+
+        if (error) {
+
+                panic("approachintersection: thread_fork_many failed: %s\n",
+                      strerror(error)
+                      );
+        }
+
+        (void) index;
+#else
         for (index = 0; index < NCARS; index++) {
 
                 error = thread_fork("approachintersection thread",
@@ -230,6 +254,7 @@ createcars(int nargs,
                               );
                 }
         }
+#endif // OPT_A1
 
         return 0;
 }
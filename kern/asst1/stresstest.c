@@ -0,0 +1,353 @@
+/*
+ * stresstest.c
+ *
+ * Stress tests for the lock-free code. Each is a kernel menu command
+ * (see ktest.h) that hammers one structure from as many directions as
+ * it can, checks that nothing was lost, duplicated or reordered, and
+ * prints "passed" or "FAILED".
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <test.h>
+#include <thread.h>
+#include <timeout.h>
+#include <atomic.h>
+#include <mpscq.h>
+#include <ktest.h>
+
+#include "opt-A1.h"
+
+#if OPT_A1
+
+////////////////////////////////////////////////////////////
+//
+// mpscqtest [NITEMS]
+//
+// One consumer thread against two kinds of producer, all on one queue:
+// timeouts that push from the clock interrupt every tick, and threads
+// that push in a tight loop (and so get interrupted part way through
+// their pushes by the timeouts). Each producer pushes NITEMS items
+// (default 1000) numbered in order. The consumer checks that every item
+// arrives exactly once, and that each producer's items arrive in the
+// order they were pushed. Once every producer is finished, a last
+// marker node is pushed; anything still missing by then was lost.
+
+// Producers of each kind
+#define MQ_NTHREADS  4
+#define MQ_NTIMERS   4
+#define MQ_NPROD     (MQ_NTHREADS + MQ_NTIMERS)
+
+// Items a timer pushes each time it fires
+#define MQ_PERTICK   8
+
+struct mq_item {
+	struct mpscq_node mi_node;      // first, so a node is its item
+	int mi_producer;
+	int mi_seq;
+};
+
+struct mq_timer {
+	struct timeout mt_timeout;
+	int mt_producer;
+	int mt_next;                    // next item to push
+};
+
+static struct mpscq mq_queue;
+static struct mpscq_node mq_end;       // pushed after the last item
+static struct mq_item *mq_items[MQ_NPROD];
+static struct mq_timer mq_timers[MQ_NTIMERS];
+static int mq_nitems;
+static int mq_total;                   // items the consumer took
+static int mq_bad;                     // consumer saw a wrong item
+
+static
+void
+mq_push(int producer, int seq)
+{
+	mpscq_push(&mq_queue, &mq_items[producer][seq].mi_node);
+}
+
+/*
+ * Timeout: push the next few items from interrupt context, and come
+ * back next tick for more.
+ */
+static
+void
+mq_tick(void *arg)
+{
+	struct mq_timer *mt = arg;
+	int i;
+
+	for (i=0; i<MQ_PERTICK && mt->mt_next < mq_nitems; i++) {
+		mq_push(mt->mt_producer, mt->mt_next++);
+	}
+	if (mt->mt_next < mq_nitems) {
+		timeout_add(&mt->mt_timeout, 1);
+	}
+}
+
+static
+void
+mq_producer(void *unused, unsigned long producer)
+{
+	int i;
+
+	(void)unused;
+
+	for (i=0; i<mq_nitems; i++) {
+		mq_push(producer, i);
+	}
+}
+
+static
+void
+mq_consumer(void *unused, unsigned long junk)
+{
+	int expect[MQ_NPROD];
+	struct mpscq_node *node;
+	struct mq_item *item;
+	int p;
+
+	(void)unused;
+	(void)junk;
+
+	for (p=0; p<MQ_NPROD; p++) {
+		expect[p] = 0;
+	}
+
+	while ((node = mpscq_wait(&mq_queue)) != &mq_end) {
+		item = (struct mq_item *)node;
+		p = item->mi_producer;
+		if (p < 0 || p >= MQ_NPROD || item->mi_seq != expect[p]) {
+			kprintf("mpscqtest: got item %d of producer %d, "
+				"expected item %d\n", item->mi_seq, p,
+				p >= 0 && p < MQ_NPROD ? expect[p] : -1);
+			mq_bad = 1;
+		}
+		else {
+			expect[p]++;
+		}
+		mq_total++;
+	}
+}
+
+int
+mpscqtest(int nargs, char **args)
+{
+	struct thread *consumer, *threads[MQ_NTHREADS];
+	int p, i, error;
+
+	if (nargs > 2) {
+		kprintf("Usage: mpscqtest [NITEMS]\n");
+		return 1;
+	}
+	mq_nitems = nargs == 2 ? atoi(args[1]) : 1000;
+	if (mq_nitems <= 0) {
+		kprintf("mpscqtest: invalid number of items\n");
+		return 1;
+	}
+
+	for (p=0; p<MQ_NPROD; p++) {
+		mq_items[p] = kmalloc(mq_nitems * sizeof(struct mq_item));
+		if (mq_items[p] == NULL) {
+			panic("mpscqtest: out of memory\n");
+		}
+		for (i=0; i<mq_nitems; i++) {
+			mq_items[p][i].mi_producer = p;
+			mq_items[p][i].mi_seq = i;
+		}
+	}
+	mpscq_init(&mq_queue);
+	mq_total = 0;
+	mq_bad = 0;
+
+	error = thread_fork_joinable("mpscqtest consumer", NULL, 0,
+				     mq_consumer, &consumer);
+	if (error) {
+		panic("mpscqtest: thread_fork_joinable failed: %s\n",
+		      strerror(error));
+	}
+
+	// Timers are producers 0 .. MQ_NTIMERS-1, threads the rest
+	for (p=0; p<MQ_NTIMERS; p++) {
+		mq_timers[p].mt_producer = p;
+		mq_timers[p].mt_next = 0;
+		timeout_set(&mq_timers[p].mt_timeout, mq_tick, &mq_timers[p]);
+		timeout_add(&mq_timers[p].mt_timeout, 1);
+	}
+	for (p=0; p<MQ_NTHREADS; p++) {
+		error = thread_fork_joinable("mpscqtest producer", NULL,
+					     MQ_NTIMERS + p, mq_producer,
+					     &threads[p]);
+		if (error) {
+			panic("mpscqtest: thread_fork_joinable failed: %s\n",
+			      strerror(error));
+		}
+	}
+
+	// Wait for every producer to finish, then mark the end
+	for (p=0; p<MQ_NTHREADS; p++) {
+		thread_join(threads[p], NULL);
+	}
+	for (p=0; p<MQ_NTIMERS; p++) {
+		while (timeout_pending(&mq_timers[p].mt_timeout)) {
+			thread_sleep_until(clock_ticks() + 1);
+		}
+	}
+	mpscq_push(&mq_queue, &mq_end);
+	thread_join(consumer, NULL);
+
+	for (p=0; p<MQ_NPROD; p++) {
+		kfree(mq_items[p]);
+	}
+
+	if (mq_total != MQ_NPROD * mq_nitems) {
+		kprintf("mpscqtest: consumer got %d items, expected %d\n",
+			mq_total, MQ_NPROD * mq_nitems);
+		mq_bad = 1;
+	}
+	if (mq_bad) {
+		kprintf("mpscqtest: FAILED\n");
+		return 1;
+	}
+	kprintf("mpscqtest: %d items from %d timers and %d threads: passed\n",
+		mq_total, MQ_NTIMERS, MQ_NTHREADS);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// atomictest [LOOPS]
+//
+// Threads and a clock interrupt timeout all update the same words:
+//   - at_addcount with atomic_add_32;
+//   - at_cascount with an atomic_cas_32 retry loop. The threads yield
+//     between reading the old value and the compare-and-swap every few
+//     rounds, so the CAS often finds the word changed and has to retry.
+// Each thread does LOOPS updates (default 10000) and the timeout a few
+// every tick while they run. Afterwards both words must equal the total
+// number of updates made.
+
+#define AT_NTHREADS  8
+#define AT_PERTICK   16
+#define AT_YIELDMASK 7                  // yield every 8th CAS round
+
+static volatile u_int32_t at_addcount;
+static volatile u_int32_t at_cascount;
+static volatile u_int32_t at_retries;  // CAS attempts that failed
+static volatile u_int32_t at_ticks;    // updates made by the timeout
+static volatile int at_stop;
+static struct timeout at_timeout;
+static int at_loops;
+
+/*
+ * CAS-increment *P, counting failed attempts. If YIELD, give up the
+ * CPU between the read and the compare-and-swap.
+ */
+static
+void
+at_casinc(volatile u_int32_t *p, int yield)
+{
+	u_int32_t old;
+
+	for (;;) {
+		old = *p;
+		if (yield) {
+			thread_yield();
+		}
+		if (atomic_cas_32(p, old, old + 1) == old) {
+			return;
+		}
+		atomic_add_32(&at_retries, 1);
+	}
+}
+
+static
+void
+at_tick(void *unused)
+{
+	int i;
+
+	(void)unused;
+
+	for (i=0; i<AT_PERTICK; i++) {
+		atomic_add_32(&at_addcount, 1);
+		at_casinc(&at_cascount, 0);
+	}
+	at_ticks += AT_PERTICK;
+
+	if (!at_stop) {
+		timeout_add(&at_timeout, 1);
+	}
+}
+
+static
+void
+at_thread(void *unused, unsigned long num)
+{
+	int i;
+
+	(void)unused;
+	(void)num;
+
+	for (i=0; i<at_loops; i++) {
+		atomic_add_32(&at_addcount, 1);
+		at_casinc(&at_cascount, (i & AT_YIELDMASK) == 0);
+	}
+}
+
+int
+atomictest(int nargs, char **args)
+{
+	struct thread *threads[AT_NTHREADS];
+	u_int32_t expect;
+	int i, error, spl;
+
+	if (nargs > 2) {
+		kprintf("Usage: atomictest [LOOPS]\n");
+		return 1;
+	}
+	at_loops = nargs == 2 ? atoi(args[1]) : 10000;
+	if (at_loops <= 0) {
+		kprintf("atomictest: invalid number of loops\n");
+		return 1;
+	}
+
+	at_addcount = at_cascount = 0;
+	at_retries = at_ticks = 0;
+	at_stop = 0;
+	timeout_set(&at_timeout, at_tick, NULL);
+	timeout_add(&at_timeout, 1);
+
+	error = thread_fork_many("atomictest", AT_NTHREADS, NULL, at_thread,
+				 1, threads);
+	if (error) {
+		panic("atomictest: thread_fork_many failed: %s\n",
+		      strerror(error));
+	}
+	for (i=0; i<AT_NTHREADS; i++) {
+		thread_join(threads[i], NULL);
+	}
+
+	// Stop the timeout; with interrupts off it can't be half way through
+	spl = splhigh();
+	at_stop = 1;
+	timeout_del(&at_timeout);
+	splx(spl);
+
+	expect = AT_NTHREADS * at_loops + at_ticks;
+	kprintf("atomictest: %u updates (%u from the clock), %u CAS retries\n",
+		expect, at_ticks, at_retries);
+	if (at_addcount != expect || at_cascount != expect) {
+		kprintf("atomictest: add count %u, cas count %u, expected %u\n",
+			at_addcount, at_cascount, expect);
+		kprintf("atomictest: FAILED\n");
+		return 1;
+	}
+	kprintf("atomictest: passed\n");
+	return 0;
+}
+
+#endif // OPT_A1
@@ -0,0 +1,851 @@
+/*
+ * synchbench.c
+ *
+ * Benchmarks for the thread system and synchronization primitives.
+ * Each is a kernel menu command (see ktest.h) that times a loop with
+ * gettime() and prints the total and the cost per operation. The
+ * numbers are wall clock time on System/161, so compare them against
+ * each other rather than reading too much into any one.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <clock.h>
+#include <test.h>
+#include <thread.h>
+#include <synch.h>
+#include <timeout.h>
+#include <ktest.h>
+
+#include "opt-A1.h"
+
+#if OPT_A1
+
+/*
+ * Report, for command CMD, that N operations of WHAT took USECS
+ * microseconds.
+ */
+static
+void
+bench_print(const char *cmd, const char *what, u_int32_t usecs, unsigned n)
+{
+	kprintf("%s: %u %s in %u us, %u.%03u us each\n", cmd, n, what,
+		usecs, usecs / n, (usecs % n) * 1000 / n);
+}
+
+/*
+ * Fork N joinable threads running FUNC(DATA1, i) into RETS, or say why
+ * not. Returns an error code.
+ */
+static
+int
+bench_fork(const char *cmd, int n, void *data1,
+	   void (*func)(void *, unsigned long), struct thread **rets)
+{
+	int error;
+
+	if (n == 0) {
+		return 0;
+	}
+	error = thread_fork_many(cmd, n, data1, func, 1, rets);
+	if (error) {
+		kprintf("%s: can't start %d threads: %s\n", cmd, n,
+			strerror(error));
+	}
+	return error;
+}
+
+static
+void
+bench_join(int n, struct thread **threads)
+{
+	int i;
+
+	for (i=0; i<n; i++) {
+		thread_join(threads[i], NULL);
+	}
+}
+
+/*
+ * Time N threads running FUNC(NULL, i) from start to finish, in
+ * microseconds. Returns 0 if they couldn't be started.
+ */
+static
+u_int32_t
+bench_run(const char *cmd, int n, void (*func)(void *, unsigned long))
+{
+	struct thread **threads;
+	time_t secs;
+	u_int32_t nsecs, usecs;
+
+	threads = kmalloc(n * sizeof(struct thread *));
+	if (threads == NULL) {
+		kprintf("%s: out of memory\n", cmd);
+		return 0;
+	}
+
+	gettime(&secs, &nsecs);
+	if (bench_fork(cmd, n, NULL, func, threads)) {
+		kfree(threads);
+		return 0;
+	}
+	bench_join(n, threads);
+	usecs = ktest_usecs(secs, nsecs);
+
+	kfree(threads);
+	return usecs > 0 ? usecs : 1;
+}
+
+////////////////////////////////////////////////////////////
+//
+// wakebench NSLEEPERS ROUNDS
+//
+// NSLEEPERS threads go to sleep on addresses of their own. Then two more
+// threads play ping-pong with thread_sleep/thread_wakeup for ROUNDS round
+// trips. Since sleepers are hashed by address, the round trip time
+// shouldn't depend on NSLEEPERS.
+
+static int wb_rounds;
+static volatile int wb_turn;       // which player may go
+static volatile int wb_asleep;     // sleepers that have gone to sleep
+static volatile int wb_done;       // sleepers may leave
+
+static
+void
+wb_sleeper(void *slots, unsigned long num)
+{
+	const int *slot = (const int *)slots + num;
+	int spl;
+
+	spl = splhigh();
+	wb_asleep++;
+	while (!wb_done) {
+		thread_sleep(slot);
+	}
+	splx(spl);
+}
+
+/*
+ * Wake the sleepers up and wait for them to go.
+ */
+static
+void
+wb_release(int nsleepers, int *slots, struct thread **sleepers)
+{
+	int i, spl;
+
+	spl = splhigh();
+	wb_done = 1;
+	for (i=0; i<nsleepers; i++) {
+		thread_wakeup(&slots[i]);
+	}
+	splx(spl);
+	bench_join(nsleepers, sleepers);
+}
+
+static
+void
+wb_player(void *unused, unsigned long me)
+{
+	int i, spl;
+
+	(void)unused;
+
+	spl = splhigh();
+	for (i=0; i<wb_rounds; i++) {
+		while (wb_turn != (int)me) {
+			thread_sleep((const void *)&wb_turn);
+		}
+		wb_turn = !me;
+		thread_wakeup((const void *)&wb_turn);
+	}
+	splx(spl);
+}
+
+int
+wakebench(int nargs, char **args)
+{
+	struct thread **sleepers, *players[2];
+	int *slots;
+	int nsleepers;
+	time_t secs;
+	u_int32_t nsecs, usecs;
+
+	if (nargs != 3) {
+		kprintf("Usage: wakebench NSLEEPERS ROUNDS\n");
+		return 1;
+	}
+	nsleepers = atoi(args[1]);
+	wb_rounds = atoi(args[2]);
+	if (nsleepers < 0 || wb_rounds <= 0) {
+		kprintf("wakebench: invalid arguments\n");
+		return 1;
+	}
+
+	sleepers = kmalloc((nsleepers+1) * sizeof(struct thread *));
+	slots = kmalloc((nsleepers+1) * sizeof(int));
+	if (sleepers == NULL || slots == NULL) {
+		kprintf("wakebench: out of memory\n");
+		goto fail;
+	}
+
+	wb_turn = 0;
+	wb_asleep = 0;
+	wb_done = 0;
+	if (bench_fork("wakebench", nsleepers, slots, wb_sleeper, sleepers)) {
+		goto fail;
+	}
+	while (wb_asleep < nsleepers) {
+		thread_yield();
+	}
+
+	gettime(&secs, &nsecs);
+	if (bench_fork("wakebench", 2, NULL, wb_player, players)) {
+		wb_release(nsleepers, slots, sleepers);
+		goto fail;
+	}
+	bench_join(2, players);
+	usecs = ktest_usecs(secs, nsecs);
+
+	wb_release(nsleepers, slots, sleepers);
+
+	kprintf("wakebench: %d unrelated sleepers\n", nsleepers);
+	bench_print("wakebench", "round trips", usecs, wb_rounds);
+	kfree(sleepers);
+	kfree(slots);
+	return 0;
+
+ fail:
+	if (sleepers != NULL) {
+		kfree(sleepers);
+	}
+	if (slots != NULL) {
+		kfree(slots);
+	}
+	return 1;
+}
+
+////////////////////////////////////////////////////////////
+//
+// dispatchbench [YIELDS]
+//
+// For 10, 100 and then 1000 threads: start them all at once and have
+// each call thread_yield() YIELDS times (default 100). Each yield is one
+// trip through the scheduler, so the time per yield is the dispatch
+// cost, which with the indexed run queue shouldn't grow with the number
+// of runnable threads. Prints the thread cache statistics at the end.
+
+static int db_yields;
+static volatile int db_ready;      // threads waiting for the start
+static volatile int db_go;         // start
+
+static
+void
+db_thread(void *unused, unsigned long num)
+{
+	int i, spl;
+
+	(void)unused;
+	(void)num;
+
+	spl = splhigh();
+	db_ready++;
+	while (!db_go) {
+		thread_sleep((const void *)&db_go);
+	}
+	splx(spl);
+
+	for (i=0; i<db_yields; i++) {
+		thread_yield();
+	}
+}
+
+int
+dispatchbench(int nargs, char **args)
+{
+	static const int counts[] = { 10, 100, 1000 };
+	struct thread **threads;
+	int n, k, spl;
+	time_t secs;
+	u_int32_t nsecs, usecs;
+
+	if (nargs > 2) {
+		kprintf("Usage: dispatchbench [YIELDS]\n");
+		return 1;
+	}
+	db_yields = nargs == 2 ? atoi(args[1]) : 100;
+	if (db_yields <= 0) {
+		kprintf("dispatchbench: invalid number of yields\n");
+		return 1;
+	}
+
+	for (k=0; k<3; k++) {
+		n = counts[k];
+		threads = kmalloc(n * sizeof(struct thread *));
+		if (threads == NULL) {
+			kprintf("dispatchbench: out of memory\n");
+			return 1;
+		}
+
+		db_ready = 0;
+		db_go = 0;
+		if (bench_fork("dispatchbench", n, NULL, db_thread, threads)) {
+			kfree(threads);
+			return 1;
+		}
+		while (db_ready < n) {
+			thread_yield();
+		}
+
+		gettime(&secs, &nsecs);
+		spl = splhigh();
+		db_go = 1;
+		thread_wakeup((const void *)&db_go);
+		splx(spl);
+		bench_join(n, threads);
+		usecs = ktest_usecs(secs, nsecs);
+
+		kprintf("dispatchbench: %d threads\n", n);
+		bench_print("dispatchbench", "yields", usecs, n * db_yields);
+		kfree(threads);
+	}
+
+	// Most of those threads should have come out of the thread cache
+	thread_cache_stats();
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// rwbench [LOOPS]
+//
+// Read-side scaling of struct rwlock. For 1, 2, 4, 8 and 16 reader
+// threads, each enters a read section LOOPS times (default 100), and
+// yields the CPU inside it, as a reader that blocks on I/O would. The
+// same is then done with an ordinary struct lock. Readers overlap under
+// the rwlock but are serialized by the lock, so the rwlock's time per
+// section should fall as readers are added while the lock's stays put.
+
+#define RB_MAXREADERS 16
+
+static int rb_loops;
+static struct rwlock *rb_rwlock;
+static struct lock *rb_lock;
+
+static
+void
+rb_rwreader(void *unused, unsigned long num)
+{
+	int i;
+
+	(void)unused;
+	(void)num;
+
+	for (i=0; i<rb_loops; i++) {
+		rw_rlock(rb_rwlock);
+		thread_yield();
+		rw_unlock(rb_rwlock);
+	}
+}
+
+static
+void
+rb_lockreader(void *unused, unsigned long num)
+{
+	int i;
+
+	(void)unused;
+	(void)num;
+
+	for (i=0; i<rb_loops; i++) {
+		lock_acquire(rb_lock);
+		thread_yield();
+		lock_release(rb_lock);
+	}
+}
+
+int
+rwbench(int nargs, char **args)
+{
+	u_int32_t rwtime, locktime;
+	int n, result = 0;
+
+	if (nargs > 2) {
+		kprintf("Usage: rwbench [LOOPS]\n");
+		return 1;
+	}
+	rb_loops = nargs == 2 ? atoi(args[1]) : 100;
+	if (rb_loops <= 0) {
+		kprintf("rwbench: invalid number of loops\n");
+		return 1;
+	}
+
+	rb_rwlock = rwlock_create("rwbench", 0);
+	rb_lock = lock_create("rwbench");
+	if (rb_rwlock == NULL || rb_lock == NULL) {
+		panic("rwbench: out of memory\n");
+	}
+
+	for (n=1; n<=RB_MAXREADERS; n*=2) {
+		rwtime = bench_run("rwbench", n, rb_rwreader);
+		locktime = bench_run("rwbench", n, rb_lockreader);
+		if (rwtime == 0 || locktime == 0) {
+			result = 1;
+			break;
+		}
+		kprintf("rwbench: %d readers\n", n);
+		bench_print("rwbench", "rwlock reads", rwtime, n * rb_loops);
+		bench_print("rwbench", "lock reads", locktime, n * rb_loops);
+	}
+
+	lock_destroy(rb_lock);
+	rwlock_destroy(rb_rwlock);
+	return result;
+}
+
+////////////////////////////////////////////////////////////
+//
+// mutexbench [ROUNDS]
+//
+// struct mutex against struct lock. First one thread locks and unlocks
+// each ROUNDS times (default 1000) with nobody else around. Then two
+// threads take turns: each holds the lock across a thread_yield(), so
+// the other is always asleep waiting for it, and every unlock hands it
+// over to the sleeper. The time per section there is mostly the handoff
+// from one thread to the other.
+
+static int mb_rounds;
+static struct mutex *mb_mutex;
+static struct lock *mb_lock;
+
+static
+void
+mb_mutexthread(void *unused, unsigned long num)
+{
+	int i;
+
+	(void)unused;
+	(void)num;
+
+	for (i=0; i<mb_rounds; i++) {
+		mutex_lock(mb_mutex);
+		thread_yield();
+		mutex_unlock(mb_mutex);
+	}
+}
+
+static
+void
+mb_lockthread(void *unused, unsigned long num)
+{
+	int i;
+
+	(void)unused;
+	(void)num;
+
+	for (i=0; i<mb_rounds; i++) {
+		lock_acquire(mb_lock);
+		thread_yield();
+		lock_release(mb_lock);
+	}
+}
+
+int
+mutexbench(int nargs, char **args)
+{
+	time_t secs;
+	u_int32_t nsecs, mtime, ltime, mhand, lhand;
+	int i, result = 1;
+
+	if (nargs > 2) {
+		kprintf("Usage: mutexbench [ROUNDS]\n");
+		return 1;
+	}
+	mb_rounds = nargs == 2 ? atoi(args[1]) : 1000;
+	if (mb_rounds <= 0) {
+		kprintf("mutexbench: invalid number of rounds\n");
+		return 1;
+	}
+
+	mb_mutex = mutex_create("mutexbench");
+	mb_lock = lock_create("mutexbench");
+	if (mb_mutex == NULL || mb_lock == NULL) {
+		panic("mutexbench: out of memory\n");
+	}
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<mb_rounds; i++) {
+		mutex_lock(mb_mutex);
+		mutex_unlock(mb_mutex);
+	}
+	mtime = ktest_usecs(secs, nsecs);
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<mb_rounds; i++) {
+		lock_acquire(mb_lock);
+		lock_release(mb_lock);
+	}
+	ltime = ktest_usecs(secs, nsecs);
+
+	mhand = bench_run("mutexbench", 2, mb_mutexthread);
+	lhand = mhand ? bench_run("mutexbench", 2, mb_lockthread) : 0;
+	if (lhand != 0) {
+		bench_print("mutexbench", "uncontended mutex sections", mtime,
+			    mb_rounds);
+		bench_print("mutexbench", "uncontended lock sections", ltime,
+			    mb_rounds);
+		bench_print("mutexbench", "mutex handoffs", mhand,
+			    2 * mb_rounds);
+		bench_print("mutexbench", "lock handoffs", lhand,
+			    2 * mb_rounds);
+		result = 0;
+	}
+
+	lock_destroy(mb_lock);
+	mutex_destroy(mb_mutex);
+	return result;
+}
+
+////////////////////////////////////////////////////////////
+//
+// barrierbench NTHREADS [ROUNDS]
+//
+// NTHREADS threads go through ROUNDS phases (default 100), all meeting
+// at the end of each. Three ways of meeting are timed:
+//   - struct barrier, reused every phase;
+//   - a fresh struct latch per phase: count down, then wait;
+//   - the semaphore idiom: a count under a mutex semaphore, and the
+//     last arrival V()s a turnstile once for each other thread.
+// The barrier and latch release all the waiters with one wakeup; the
+// semaphore loop wakes them one V() at a time.
+
+static int bb_nthreads;
+static int bb_rounds;
+static struct barrier *bb_barrier;
+static struct latch **bb_latches;
+static struct semaphore *bb_mutex;
+static struct semaphore *bb_turnstile[2];
+static int bb_count;
+
+static
+void
+bb_barrierthread(void *unused, unsigned long num)
+{
+	int r;
+
+	(void)unused;
+	(void)num;
+
+	for (r=0; r<bb_rounds; r++) {
+		barrier_wait(bb_barrier);
+	}
+}
+
+static
+void
+bb_latchthread(void *unused, unsigned long num)
+{
+	int r;
+
+	(void)unused;
+	(void)num;
+
+	for (r=0; r<bb_rounds; r++) {
+		latch_countdown(bb_latches[r]);
+		latch_wait(bb_latches[r]);
+	}
+}
+
+static
+void
+bb_semthread(void *unused, unsigned long num)
+{
+	struct semaphore *turnstile;
+	int r, i;
+
+	(void)unused;
+	(void)num;
+
+	for (r=0; r<bb_rounds; r++) {
+		/*
+		 * Alternate turnstiles, so a thread that races into the
+		 * next phase can't take a unit meant for this one.
+		 */
+		turnstile = bb_turnstile[r & 1];
+
+		P(bb_mutex);
+		if (++bb_count == bb_nthreads) {
+			bb_count = 0;
+			for (i=0; i<bb_nthreads-1; i++) {
+				V(turnstile);
+			}
+			V(bb_mutex);
+		}
+		else {
+			V(bb_mutex);
+			P(turnstile);
+		}
+	}
+}
+
+int
+barrierbench(int nargs, char **args)
+{
+	u_int32_t btime, ltime, stime;
+	int r, result = 1;
+
+	if (nargs != 2 && nargs != 3) {
+		kprintf("Usage: barrierbench NTHREADS [ROUNDS]\n");
+		return 1;
+	}
+	bb_nthreads = atoi(args[1]);
+	bb_rounds = nargs == 3 ? atoi(args[2]) : 100;
+	if (bb_nthreads <= 0 || bb_rounds <= 0) {
+		kprintf("barrierbench: invalid arguments\n");
+		return 1;
+	}
+
+	bb_latches = kmalloc(bb_rounds * sizeof(struct latch *));
+	if (bb_latches == NULL) {
+		kprintf("barrierbench: out of memory\n");
+		return 1;
+	}
+	for (r=0; r<bb_rounds; r++) {
+		bb_latches[r] = latch_create("barrierbench", bb_nthreads);
+		if (bb_latches[r] == NULL) {
+			panic("barrierbench: out of memory\n");
+		}
+	}
+	bb_barrier = barrier_create("barrierbench", bb_nthreads);
+	bb_mutex = sem_create("barrierbench mutex", 1);
+	bb_turnstile[0] = sem_create("barrierbench turnstile", 0);
+	bb_turnstile[1] = sem_create("barrierbench turnstile", 0);
+	if (bb_barrier == NULL || bb_mutex == NULL ||
+	    bb_turnstile[0] == NULL || bb_turnstile[1] == NULL) {
+		panic("barrierbench: out of memory\n");
+	}
+	bb_count = 0;
+
+	btime = bench_run("barrierbench", bb_nthreads, bb_barrierthread);
+	ltime = btime ? bench_run("barrierbench", bb_nthreads,
+				  bb_latchthread) : 0;
+	stime = ltime ? bench_run("barrierbench", bb_nthreads,
+				  bb_semthread) : 0;
+	if (stime != 0) {
+		kprintf("barrierbench: %d threads\n", bb_nthreads);
+		bench_print("barrierbench", "barrier phases", btime, bb_rounds);
+		bench_print("barrierbench", "latch phases", ltime, bb_rounds);
+		bench_print("barrierbench", "semaphore phases", stime,
+			    bb_rounds);
+		result = 0;
+	}
+
+	sem_destroy(bb_turnstile[1]);
+	sem_destroy(bb_turnstile[0]);
+	sem_destroy(bb_mutex);
+	barrier_destroy(bb_barrier);
+	for (r=0; r<bb_rounds; r++) {
+		latch_destroy(bb_latches[r]);
+	}
+	kfree(bb_latches);
+	return result;
+}
+
+////////////////////////////////////////////////////////////
+//
+// timeoutbench [LOOPS]
+//
+// What the timed waits cost when they don't have to wait. LOOPS rounds
+// (default 10000) each of: P/V against P_timeout/V on a semaphore that
+// always has a unit, and lock_acquire/lock_release against
+// lock_acquire_timeout/lock_release on a lock nobody else wants. Since
+// nobody waits, the timed calls should never arm a timeout, and cost
+// the same as the plain ones.
+
+// Timeout given to the timed calls; never reached
+#define TB_NTICKS HZ
+
+int
+timeoutbench(int nargs, char **args)
+{
+	struct semaphore *sem;
+	struct lock *lock;
+	time_t secs;
+	u_int32_t nsecs, ptime, ptotime, ltime, ltotime;
+	int loops, i, failed = 0;
+
+	if (nargs > 2) {
+		kprintf("Usage: timeoutbench [LOOPS]\n");
+		return 1;
+	}
+	loops = nargs == 2 ? atoi(args[1]) : 10000;
+	if (loops <= 0) {
+		kprintf("timeoutbench: invalid number of loops\n");
+		return 1;
+	}
+
+	sem = sem_create("timeoutbench", 1);
+	lock = lock_create("timeoutbench");
+	if (sem == NULL || lock == NULL) {
+		panic("timeoutbench: out of memory\n");
+	}
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<loops; i++) {
+		P(sem);
+		V(sem);
+	}
+	ptime = ktest_usecs(secs, nsecs);
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<loops; i++) {
+		if (P_timeout(sem, TB_NTICKS)) {
+			failed++;
+			continue;
+		}
+		V(sem);
+	}
+	ptotime = ktest_usecs(secs, nsecs);
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<loops; i++) {
+		lock_acquire(lock);
+		lock_release(lock);
+	}
+	ltime = ktest_usecs(secs, nsecs);
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<loops; i++) {
+		if (lock_acquire_timeout(lock, TB_NTICKS)) {
+			failed++;
+			continue;
+		}
+		lock_release(lock);
+	}
+	ltotime = ktest_usecs(secs, nsecs);
+
+	lock_destroy(lock);
+	sem_destroy(sem);
+
+	if (failed) {
+		kprintf("timeoutbench: %d uncontended timed waits timed out\n",
+			failed);
+		return 1;
+	}
+	bench_print("timeoutbench", "P/V", ptime, loops);
+	bench_print("timeoutbench", "P_timeout/V", ptotime, loops);
+	bench_print("timeoutbench", "lock_acquire/release", ltime, loops);
+	bench_print("timeoutbench", "lock_acquire_timeout/release", ltotime,
+		    loops);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+//
+// uptimebench [LOOPS]
+//
+// clock_uptime(), which reads through a seqlock, against reading the
+// uptime with interrupts off as it used to be (clock_uptime_spl()).
+// LOOPS reads (default 10000) each way, first with only the clock
+// interrupt writing, then again with a thread writing as fast as it can
+// (clock_uptime_touch()). The writer takes its share of the CPU in the
+// second run, so compare the two reads with each other there rather
+// than with the first run. The uptime must never go backwards.
+
+static volatile int ub_stop;
+
+static
+void
+ub_writer(void *unused, unsigned long num)
+{
+	(void)unused;
+	(void)num;
+
+	while (!ub_stop) {
+		clock_uptime_touch();
+	}
+}
+
+/*
+ * Read the uptime LOOPS times, through the seqlock if SEQ is set and
+ * with interrupts off if not. Returns the time taken in microseconds,
+ * and adds the times the uptime went backwards to *BACKWARDS.
+ */
+static
+u_int32_t
+ub_read(int seq, int loops, int *backwards)
+{
+	time_t secs;
+	u_int32_t nsecs, s, t, now, last = 0;
+	int i;
+
+	gettime(&secs, &nsecs);
+	for (i=0; i<loops; i++) {
+		if (seq) {
+			clock_uptime(&s, &t);
+		}
+		else {
+			clock_uptime_spl(&s, &t);
+		}
+		now = s * HZ + t;
+		if (i > 0 && (int)(now - last) < 0) {
+			(*backwards)++;
+		}
+		last = now;
+	}
+	return ktest_usecs(secs, nsecs);
+}
+
+int
+uptimebench(int nargs, char **args)
+{
+	struct thread *writer;
+	u_int32_t seqtime, spltime;
+	int loops, withwriter, backwards = 0;
+
+	if (nargs > 2) {
+		kprintf("Usage: uptimebench [LOOPS]\n");
+		return 1;
+	}
+	loops = nargs == 2 ? atoi(args[1]) : 10000;
+	if (loops <= 0) {
+		kprintf("uptimebench: invalid number of loops\n");
+		return 1;
+	}
+
+	for (withwriter=0; withwriter<2; withwriter++) {
+		if (withwriter) {
+			ub_stop = 0;
+			if (bench_fork("uptimebench", 1, NULL, ub_writer,
+				       &writer)) {
+				return 1;
+			}
+		}
+
+		seqtime = ub_read(1, loops, &backwards);
+		spltime = ub_read(0, loops, &backwards);
+
+		if (withwriter) {
+			ub_stop = 1;
+			bench_join(1, &writer);
+		}
+
+		kprintf("uptimebench: %s\n",
+			withwriter ? "with a writer thread" : "no writer thread");
+		bench_print("uptimebench", "clock_uptime (seqlock)", seqtime,
+			    loops);
+		bench_print("uptimebench", "clock_uptime_spl (splhigh)",
+			    spltime, loops);
+	}
+
+	if (backwards) {
+		kprintf("uptimebench: uptime went backwards %d times\n",
+			backwards);
+		kprintf("uptimebench: FAILED\n");
+		return 1;
+	}
+	return 0;
+}
+
+#endif // OPT_A1
@@ -0,0 +1,113 @@
+#ifndef _ATOMIC_H_
+#define _ATOMIC_H_
+
+/*
+ * Atomic operations on 32-bit words.
+ *
+ *     membar             - loads and stores before it complete before
+ *                          any after it.
+ *     atomic_cas_32      - if *P equals OLD, store NEW. Returns the old
+ *                          value of *P; the store happened if and only if
+ *                          that equals OLD.
+ *     atomic_swap_32     - store NEW in *P, returning the old value.
+ *     atomic_add_32      - add DELTA to *P, returning the new value.
+ *                          (Subtract by adding a negative number.)
+ *     atomic_fetch_or_32 - OR BITS into *P, returning the old value.
+ *     atomic_cas_ptr,
+ *     atomic_swap_ptr    - the same, on pointers.
+ *
+ * Normally these are ll/sc sequences (see <machine/atomic.h>), which are
+ * atomic against other processors as well as interrupts. With "options
+ * nollsc" they are done with interrupts off instead, for processors
+ * without ll/sc. That is only atomic on a uniprocessor.
+ */
+
+#include "opt-nollsc.h"
+
+#if OPT_NOLLSC
+
+#include <machine/spl.h>
+
+static __inline
+void
+membar(void)
+{
+	/* One processor sees its own accesses in order; stop the compiler. */
+	__asm volatile("" : : : "memory");
+}
+
+static __inline
+u_int32_t
+atomic_cas_32(volatile u_int32_t *p, u_int32_t old, u_int32_t new)
+{
+	int spl = splhigh();
+	u_int32_t prev = *p;
+
+	if (prev == old) {
+		*p = new;
+	}
+	splx(spl);
+	return prev;
+}
+
+static __inline
+u_int32_t
+atomic_swap_32(volatile u_int32_t *p, u_int32_t new)
+{
+	int spl = splhigh();
+	u_int32_t prev = *p;
+
+	*p = new;
+	splx(spl);
+	return prev;
+}
+
+static __inline
+u_int32_t
+atomic_add_32(volatile u_int32_t *p, u_int32_t delta)
+{
+	int spl = splhigh();
+	u_int32_t result = *p + delta;
+
+	*p = result;
+	splx(spl);
+	return result;
+}
+
+static __inline
+u_int32_t
+atomic_fetch_or_32(volatile u_int32_t *p, u_int32_t bits)
+{
+	int spl = splhigh();
+	u_int32_t prev = *p;
+
+	*p = prev | bits;
+	splx(spl);
+	return prev;
+}
+
+#else
+
+#include <machine/atomic.h>
+
+#endif /* OPT_NOLLSC */
+
+/* Pointers are 32 bits on every platform this kernel runs on. */
+
+static __inline
+void *
+atomic_cas_ptr(volatile void *p, void *old, void *new)
+{
+	return (void *)atomic_cas_32((volatile u_int32_t *)p,
+				     (u_int32_t)old, (u_int32_t)new);
+}
+
+static __inline
+void *
+atomic_swap_ptr(volatile void *p, void *new)
+{
+	return (void *)atomic_swap_32((volatile u_int32_t *)p,
+				      (u_int32_t)new);
+}
+
+#endif /* _ATOMIC_H_ */
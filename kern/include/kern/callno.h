@@ -40,6 +40,9 @@
 #define SYS___getcwd     29
 #define SYS_stat         30
 #define SYS_lstat        31
+#define SYS_futex_wait   32
+#define SYS_futex_wake   33
+#define SYS_spawn        34
 /*CALLEND*/
 
 
@@ -0,0 +1,82 @@
+#ifndef _KTEST_H_
+#define _KTEST_H_
+
+/*
+ * Kernel menu tests and benchmarks for the thread and process systems,
+ * beyond the assignment problems declared in test.h. Each one is a menu
+ * command: it takes the usual (nargs, args), prints what it measured,
+ * and returns 0 on success or nonzero if a check failed or the
+ * arguments were bad.
+ *
+ *     pitest      - (asst1/pitest.c) priority inversion: a high
+ *                   priority thread blocked on a lock held by a low
+ *                   priority one, with CPU hogs in between, must get
+ *                   the lock in bounded time, and must not with
+ *                   inheritance off. Needs "options mlfq".
+ *     sharetest   - (asst1/sharetest.c) threads given tickets 1:2:4
+ *                   must get the CPU in that ratio. Needs "options
+ *                   stride".
+ *     wakebench   - (asst1/synchbench.c) sleep/wakeup round trip time
+ *                   with a given number of unrelated sleepers.
+ *     dispatchbench - (asst1/synchbench.c) cost of a thread_yield()
+ *                   with 10, 100 and 1000 runnable threads.
+ *     rwbench     - (asst1/synchbench.c) time per read section under an
+ *                   rwlock against a plain lock, for 1 to 16 readers.
+ *     mutexbench  - (asst1/synchbench.c) struct mutex against struct
+ *                   lock, uncontended and handing off between threads.
+ *     barrierbench - (asst1/synchbench.c) time per phase for threads
+ *                   meeting at a barrier, a latch, or a semaphore loop.
+ *     timeoutbench - (asst1/synchbench.c) uncontended P and lock_acquire
+ *                   against P_timeout and lock_acquire_timeout.
+ *     uptimebench - (asst1/synchbench.c) clock_uptime() through the
+ *                   seqlock against reading with interrupts off, with
+ *                   and without a thread writing.
+ *     mpscqtest   - (asst1/stresstest.c) clock interrupt and thread
+ *                   producers against one consumer on an mpscq.
+ *     atomictest  - (asst1/stresstest.c) contended atomic_add_32 and
+ *                   atomic_cas_32 from threads and the clock interrupt.
+ *     procstorm   - (asst1/procstorm.c) fork/_exit/waitpid storm; the
+ *                   live and zombie process counts must come back down.
+ *     pidbench    - (asst1/procstorm.c) cost of fork/_exit/waitpid with
+ *                   the pid table as it is and with 90% of it in use.
+ *
+ * ktest_usecs() is the stopwatch the benchmarks use: microseconds since
+ * a time read with gettime().
+ */
+
+#include <clock.h>
+#include "opt-A1.h"
+#include "opt-A2.h"
+
+static __inline
+u_int32_t
+ktest_usecs(time_t ssecs, u_int32_t snsecs)
+{
+	time_t secs, rsecs;
+	u_int32_t nsecs, rnsecs;
+
+	gettime(&secs, &nsecs);
+	getinterval(ssecs, snsecs, secs, nsecs, &rsecs, &rnsecs);
+	return rsecs * 1000000 + rnsecs / 1000;
+}
+
+#if OPT_A1
+int pitest(int nargs, char **args);
+int sharetest(int nargs, char **args);
+int wakebench(int nargs, char **args);
+int dispatchbench(int nargs, char **args);
+int rwbench(int nargs, char **args);
+int mutexbench(int nargs, char **args);
+int barrierbench(int nargs, char **args);
+int timeoutbench(int nargs, char **args);
+int uptimebench(int nargs, char **args);
+int mpscqtest(int nargs, char **args);
+int atomictest(int nargs, char **args);
+#endif // OPT_A1
+
+#if OPT_A2
+int procstorm(int nargs, char **args);
+int pidbench(int nargs, char **args);
+#endif // OPT_A2
+
+#endif /* _KTEST_H_ */
@@ -0,0 +1,62 @@
+#ifndef _LOCKSTAT_H_
+#define _LOCKSTAT_H_
+
+/*
+ * Lock contention statistics ("options lockstat").
+ *
+ * Every semaphore, lock and CV points at a statistics record shared by
+ * all objects of the same kind with the same name, so e.g. every
+ * "kitchen lock" ever created adds up in one place. Records are never
+ * freed; they outlive the objects that feed them. The table holds at
+ * most LOCKSTAT_MAXRECS names; objects with names beyond that all add
+ * up in one "(other)" record per kind.
+ *
+ *     lockstat_get      - find or make the record for NAME and KIND.
+ *                         Returns NULL if out of memory, in which case
+ *                         the object simply isn't counted.
+ *     lockstat_acquired - count a P, lock acquisition or cv wakeup.
+ *                         CONTENDED says whether we had to sleep, and
+ *                         WAITED for how many clock ticks.
+ *     lockstat_released - count a V, lock release, or cv signal or
+ *                         broadcast, and the number of threads it woke.
+ *                         For locks, HELD is how many ticks it was held.
+ *     lockstat_dump     - print the table to the console.
+ *     lockstat_reset    - zero every record.
+ *     cmd_lockstat      - kernel menu command: "lockstat" dumps the
+ *                         table, "lockstat reset" zeroes it.
+ *
+ * Times are in clock ticks (see clock_ticks()), so anything shorter
+ * than a tick counts as 0.
+ */
+
+#define LOCKSTAT_SEM   0
+#define LOCKSTAT_LOCK  1
+#define LOCKSTAT_CV    2
+
+/* Hold time histogram buckets: 0, 1, 2-3, 4-7, ... , 64+ ticks */
+#define LOCKSTAT_NHIST 8
+
+/* Most distinct names kept before sharing the "(other)" records */
+#define LOCKSTAT_MAXRECS 256
+
+struct lockstat {
+	char *ls_name;
+	int ls_kind;
+	unsigned ls_acquires;        /* P / acquire / cv wakeup */
+	unsigned ls_contended;       /* ... that had to sleep */
+	u_int32_t ls_waitticks;      /* total ticks spent asleep */
+	u_int32_t ls_waitmax;        /* longest single wait */
+	unsigned ls_releases;        /* V / release / signal+broadcast */
+	unsigned ls_wakeups;         /* threads woken by them */
+	unsigned ls_holdhist[LOCKSTAT_NHIST];
+	struct lockstat *ls_next;
+};
+
+struct lockstat *lockstat_get(const char *name, int kind);
+void lockstat_acquired(struct lockstat *ls, int contended, u_int32_t waited);
+void lockstat_released(struct lockstat *ls, int wakeups, u_int32_t held);
+void lockstat_dump(void);
+void lockstat_reset(void);
+int cmd_lockstat(int nargs, char **args);
+
+#endif /* _LOCKSTAT_H_ */
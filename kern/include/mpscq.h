@@ -0,0 +1,47 @@
+#ifndef _MPSCQ_H_
+#define _MPSCQ_H_
+
+/*
+ * Lock-free multi-producer, single-consumer queue.
+ *
+ * Meant for handing work from interrupt handlers (or any number of
+ * threads) to one kernel worker thread. Pushing is a single atomic swap
+ * plus a store: it never blocks, never allocates and doesn't need
+ * interrupts off, so it's safe anywhere. Only one thread may pop.
+ *
+ * The queue is intrusive: embed a struct mpscq_node in whatever is being
+ * queued, and get back from the node to the containing object yourself.
+ * A node must not be pushed again until it has been popped.
+ *
+ *     mpscq_init   - initialize an empty queue.
+ *     mpscq_push   - add NODE at the tail, and wake the consumer if it's
+ *                    asleep in mpscq_wait.
+ *     mpscq_pop    - remove and return the node at the head, or NULL if
+ *                    there's nothing there. (Also NULL, briefly, if a
+ *                    producer is half way through a push; the push
+ *                    wakes the consumer when it finishes.)
+ *     mpscq_wait   - as mpscq_pop, but sleep until there's a node.
+ *                    Not from an interrupt handler.
+ *
+ * This is Dmitry Vyukov's intrusive MPSC queue: producers swap
+ * themselves onto the tail, and a permanent stub node lets the
+ * consumer take the last real node without racing them.
+ */
+
+struct mpscq_node {
+	struct mpscq_node *volatile mn_next;
+};
+
+struct mpscq {
+	struct mpscq_node *volatile mq_head;  /* last pushed; producers */
+	struct mpscq_node *mq_tail;           /* next to pop; consumer */
+	struct mpscq_node mq_stub;
+	volatile int mq_sleeping;             /* consumer in mpscq_wait */
+};
+
+void mpscq_init(struct mpscq *q);
+void mpscq_push(struct mpscq *q, struct mpscq_node *node);
+struct mpscq_node *mpscq_pop(struct mpscq *q);
+struct mpscq_node *mpscq_wait(struct mpscq *q);
+
+#endif /* _MPSCQ_H_ */
@@ -3,16 +3,30 @@
 
 #include <machine/trapframe.h>
 
-struct array;
+struct process;
+
+/* Pids run from 0 to PROC_PIDMAX-1. A multiple of 32. */
+#define PROC_PIDMAX    4096
+
+/* 32-bit words of the pid bitmap, and of its summary of full words */
+#define PROC_PIDWORDS  (PROC_PIDMAX / 32)
+#define PROC_PIDSUMS   ((PROC_PIDWORDS + 31) / 32)
+
+/* Chains in the process table's pid hash. A power of 2. */
+#define PROC_HASHSIZE  128
 
 /*
  * Process table.
  */
 
 struct proc_table {
-    u_int32_t max_processes;
-    struct array *proc_list;
-    pid_t nextpid;
+    u_int32_t max_processes;    /* limit on nprocs; see process_setlimit */
+    u_int32_t nprocs;           /* processes in the table */
+    u_int32_t nzombies;         /* of those, how many have exited */
+    struct process *hash[PROC_HASHSIZE];  /* chains keyed by pid */
+    u_int32_t pid_map[PROC_PIDWORDS];   /* bit set per pid in use */
+    u_int32_t pid_full[PROC_PIDSUMS];   /* bit set per full pid_map word */
+    pid_t nextpid;              /* where to start looking for a free pid */
 };
 
 
@@ -24,12 +38,69 @@ struct thread;
 
 struct process {
     pid_t p_id, p_parent;
-	struct thread *p_thread;
+	struct thread *p_thread;     /* NULL once exited */
+
+    /*
+     * Once a process exits, all that's left of it is this structure,
+     * holding the exit code until the parent collects it with waitpid.
+     */
+    int p_exited;
+    int p_exitcode;
+
+    // Family links, owned by the process table
+    struct process *p_parentp;   /* parent, or NULL if orphaned */
+    struct process *p_children;  /* first child */
+    struct process *p_sibling;   /* next child of the same parent */
+    struct process **p_sibprev;  /* whatever points at us in that list */
+    struct process *p_hashnext;  /* next in the pid hash chain */
 };
 
+/* The process currently running. */
+extern struct process *curproc;
+
 /* Get a pointer to the current process' parent */
 struct process *process_getparent(void);
 
+/* Find the process with pid PID, or NULL if there isn't one */
+struct process *process_lookup(pid_t pid);
+
+/*
+ * Make a new, empty child of the current process, with a pid, and
+ * return it in *CHILDP. Starting a thread in it is up to the caller:
+ * the thread calls process_enter() first thing, or if the thread can't
+ * be started the caller throws the child away with process_undo().
+ * Returns EAGAIN at the process limit, or ENOMEM.
+ */
+int process_create(struct process **childp);
+void process_enter(struct process *p);
+void process_undo(struct process *child);
+
+/*
+ * Hand all of P's children over to NEWPARENT, or orphan them if it is
+ * NULL. Takes time proportional to the number of children.
+ */
+void process_reparent(struct process *p, struct process *newparent);
+
+/*
+ * Set the most processes that may exist at once (at most PROC_PIDMAX).
+ * Returns EINVAL if out of range. process_getlimit() gives the current
+ * limit.
+ */
+int process_setlimit(u_int32_t max);
+u_int32_t process_getlimit(void);
+
+/*
+ * Report how many processes there are, and how many of those are
+ * zombies (each holding a pid and a struct process, and nothing else).
+ */
+void process_getcounts(u_int32_t *nprocs, u_int32_t *nzombies);
+
+/*
+ * Kernel menu command: "proclimit" prints the process limit and counts,
+ * "proclimit N" sets the limit to N.
+ */
+int cmd_proclimit(int nargs, char **args);
+
 /* Call once during startup. */
 struct process *process_bootstrap(void);
 
@@ -0,0 +1,83 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+/*
+ * Scheduler-related function calls.
+ *
+ *     scheduler     - run the scheduler and choose the next thread to run.
+ *     make_runnable - add the specified thread to the run queue. If it's
+ *                     already on the run queue or sleeping, weird things
+ *                     may happen. Returns an error code.
+ *
+ *     scheduler_tick  - account one clock tick to the current thread.
+ *                     Called from hardclock; returns nonzero if the
+ *                     current thread should be preempted.
+ *     scheduler_block - note that the specified thread is about to go
+ *                     to sleep voluntarily.
+ *
+ *     scheduler_donate - set the priority donated to a thread by
+ *                     priority inheritance (PRI_NONE to clear it).
+ *     scheduler_priority - effective priority of a thread, donation
+ *                     included. Lower numbers are higher priority.
+ *     scheduler_setboost - (mlfq only) turn the periodic priority boost
+ *                     on or off, for testing. Returns the old setting.
+ *
+ *     print_run_queue - dump the run queue to the console for debugging.
+ *
+ *     scheduler_bootstrap - initialize scheduler data
+ *                           (must happen early in boot)
+ *     scheduler_shutdown -  clean up scheduler data
+ *     scheduler_preallocate - ensure space for at least NTHREADS threads.
+ *                           Returns an error code.
+ *
+ *     scheduler_settickets - (stride only) set a thread's tickets.
+ *                     Returns an error code.
+ *     scheduler_getshare - (stride only) ticks the thread has run, and
+ *                     ticks run by all threads, since boot.
+ *
+ * The policy is picked at build time: round robin by default, a
+ * multi-level feedback queue with "options mlfq" in the kernel config,
+ * or proportional-share stride scheduling with "options stride".
+ */
+
+#include "opt-mlfq.h"
+#include "opt-stride.h"
+
+struct thread;
+
+/* No priority donated. Worse than any real priority. */
+#define PRI_NONE  32
+
+struct thread *scheduler(void);
+int make_runnable(struct thread *t);
+
+int scheduler_tick(void);
+void scheduler_block(struct thread *t);
+
+void scheduler_donate(struct thread *t, int pri);
+int scheduler_priority(struct thread *t);
+
+#if OPT_MLFQ
+int scheduler_setboost(int enable);
+#endif // OPT_MLFQ
+
+#if OPT_STRIDE
+/* Tickets given to new threads, and the most any thread may have. */
+#define STRIDE_DEFTICKETS  100
+#define STRIDE_MAXTICKETS  10000
+
+/* Stride of a thread with one ticket. */
+#define STRIDE1            (1 << 20)
+
+int scheduler_settickets(struct thread *t, unsigned tickets);
+void scheduler_getshare(struct thread *t, unsigned *ticks, unsigned *total);
+#endif // OPT_STRIDE
+
+void print_run_queue(void);
+
+void scheduler_bootstrap(void);
+int scheduler_preallocate(int numthreads);
+void scheduler_killall(void);
+void scheduler_shutdown(void);
+
+#endif /* _SCHEDULER_H_ */
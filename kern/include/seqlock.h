@@ -0,0 +1,71 @@
+#ifndef _SEQLOCK_H_
+#define _SEQLOCK_H_
+
+/*
+ * Sequence lock, for small bits of shared state that are read much more
+ * often than they're written (counters, clock snapshots).
+ *
+ * Writers bump the sequence number before and after changing the data,
+ * so it is odd while a write is in progress. Readers never block and
+ * never turn interrupts off: they note the sequence number, copy the
+ * data, and go round again if the number has changed in the meantime.
+ *
+ *     seq_readbegin - start a read; returns the sequence number to pass
+ *                     to seq_readretry.
+ *     seq_readretry - nonzero if a write overlapped the read, and the
+ *                     copy must be thrown away and taken again.
+ *     seq_writebegin, seq_writeend - bracket a change to the data.
+ *
+ * Writers must still exclude each other; in this kernel that's done by
+ * only writing with interrupts off. A reader mustn't run from an
+ * interrupt that could have broken into a write, or it would spin for
+ * ever; writing with interrupts off rules that out too.
+ */
+
+#include <atomic.h>
+
+struct seqlock {
+	volatile unsigned sl_seq;
+};
+
+#define SEQLOCK_INITIALIZER  { 0 }
+
+static __inline
+unsigned
+seq_readbegin(const struct seqlock *sl)
+{
+	unsigned seq;
+
+	do {
+		seq = sl->sl_seq;
+	} while (seq & 1);
+	membar();
+
+	return seq;
+}
+
+static __inline
+int
+seq_readretry(const struct seqlock *sl, unsigned seq)
+{
+	membar();
+	return sl->sl_seq != seq;
+}
+
+static __inline
+void
+seq_writebegin(struct seqlock *sl)
+{
+	sl->sl_seq++;
+	membar();
+}
+
+static __inline
+void
+seq_writeend(struct seqlock *sl)
+{
+	membar();
+	sl->sl_seq++;
+}
+
+#endif /* _SEQLOCK_H_ */
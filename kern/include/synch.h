@@ -6,9 +6,26 @@
 #define _SYNCH_H_
 
 #include "opt-A1.h"
+#include "opt-mlfq.h"
+#include "opt-lockstat.h"
+
+#if OPT_LOCKSTAT
+struct lockstat;
+#endif // OPT_LOCKSTAT
 
 #if OPT_A1
-#include <queue.h>
+#include <kern/errno.h>
+
+/*
+ * Returned by the timed waits below. It has a value of its own, so a
+ * caller can tell a timeout from EAGAIN. kern/errno.h, and the strerror
+ * table that matches it, aren't part of this tree, so it's picked here,
+ * clear of the standard codes. Only kernel callers ever see it; don't
+ * hand it to strerror() or return it to user level.
+ */
+#ifndef ETIMEDOUT
+#define ETIMEDOUT 64
+#endif
 #endif // OPT_A1
 
 /*
@@ -17,6 +34,14 @@
  *     P (proberen): decrement count. If the count is 0, block until
  *                   the count is 1 again before decrementing.
  *     V (verhogen): increment count.
+ *
+ * (Under OPT_A1, V hands the count straight to the oldest thread blocked
+ * in P, if there is one, instead of waking every sleeper to race for it.)
+ *
+ * Under OPT_A1 there is also
+ *     P_timeout: as P, but give up and return ETIMEDOUT if the count has
+ *                not become available within the given number of clock
+ *                ticks. Returns 0 once the count has been decremented.
  * 
  * Both operations are atomic.
  *
@@ -27,11 +52,17 @@
 struct semaphore {
 	char *name;
 	volatile int count;
+#if OPT_LOCKSTAT
+	struct lockstat *stat;
+#endif // OPT_LOCKSTAT
 };
 
 struct semaphore *sem_create(const char *name, int initial_count);
 void              P(struct semaphore *);
 void              V(struct semaphore *);
+#if OPT_A1
+int               P_timeout(struct semaphore *, int nticks);
+#endif // OPT_A1
 void              sem_destroy(struct semaphore *);
 
 
@@ -41,9 +72,14 @@ void              sem_destroy(struct semaphore *);
  *    lock_acquire - Get the lock. Only one thread can hold the lock at the
  *                   same time.
  *    lock_release - Free the lock. Only the thread holding the lock may do
- *                   this.
+ *                   this. (Under OPT_A1, ownership passes directly to the
+ *                   longest waiting thread, if any; see below for
+ *                   OPT_MLFQ.)
  *    lock_do_i_hold - Return true if the current thread holds the lock; 
  *                   false otherwise.
+ *    lock_acquire_timeout - (OPT_A1) As lock_acquire, but return ETIMEDOUT
+ *                   without the lock if it could not be had within the
+ *                   given number of clock ticks. Returns 0 on success.
  *
  * These operations must be atomic. You get to write them.
  *
@@ -52,6 +88,13 @@ void              sem_destroy(struct semaphore *);
  *
  * The name field is for easier debugging. A copy of the name is made
  * internally.
+ *
+ * Under OPT_MLFQ, locks do transitive priority inheritance: a thread that
+ * blocks in lock_acquire lends its priority to the owner (and to the owner
+ * of the lock that owner is blocked on, and so on), and lock_release takes
+ * the loan back. The lock goes to the waiter with the best effective
+ * priority rather than the oldest. lock_setinherit(0) turns inheritance
+ * off (for testing) and returns whether it was on.
  */
 
 struct lock {
@@ -59,6 +102,19 @@ struct lock {
 #if OPT_A1
     volatile int occupied;
     volatile struct thread *owner;
+
+    // Direct handoffs done by lock_release(), and the wakeups they saved
+    volatile unsigned handoffs;
+    volatile unsigned wakeups_saved;
+
+#if OPT_MLFQ
+    // Next lock held by the same owner, for priority inheritance
+    struct lock *next_held;
+#endif // OPT_MLFQ
+#if OPT_LOCKSTAT
+    struct lockstat *stat;
+    u_int32_t acquired_at;          // clock tick the owner got it
+#endif // OPT_LOCKSTAT
 #else
 	// add what you need here
 	// (don't forget to mark things volatile as needed)
@@ -72,7 +128,11 @@ int          lock_do_i_hold(struct lock *);
 void         lock_destroy(struct lock *);
 #if OPT_A1
 int          lock_tryacquire(struct lock *);
+int          lock_acquire_timeout(struct lock *, int nticks);
 #endif // OPT_A1
+#if OPT_A1 && OPT_MLFQ
+int          lock_setinherit(int enable);
+#endif // OPT_A1 && OPT_MLFQ
 
 
 /*
@@ -87,6 +147,9 @@ int          lock_tryacquire(struct lock *);
  *                   waking up again, re-acquire the lock.
  *    cv_signal    - Wake up one thread that's sleeping on this CV.
  *    cv_broadcast - Wake up all threads sleeping on this CV.
+ *    cv_timedwait - (OPT_A1) As cv_wait, but stop waiting after the given
+ *                   number of clock ticks. The lock is re-acquired either
+ *                   way. Returns 0 if signalled, ETIMEDOUT otherwise.
  *
  * For all three operations, the current thread must hold the lock passed 
  * in. Note that under normal circumstances the same lock should be used
@@ -104,8 +167,10 @@ int          lock_tryacquire(struct lock *);
 struct cv {
 	char *name;
 #if OPT_A1
-    volatile int count;
-    struct queue *q;
+    // Waiters sleep on the cv's address (see synch.c)
+#if OPT_LOCKSTAT
+    struct lockstat *stat;
+#endif // OPT_LOCKSTAT
 #else
 	// add what you need here
 	// (don't forget to mark things volatile as needed)
@@ -116,6 +181,148 @@ struct cv *cv_create(const char *name);
 void       cv_wait(struct cv *cv, struct lock *lock);
 void       cv_signal(struct cv *cv, struct lock *lock);
 void       cv_broadcast(struct cv *cv, struct lock *lock);
+#if OPT_A1
+int        cv_timedwait(struct cv *cv, struct lock *lock, int nticks);
+#endif // OPT_A1
 void       cv_destroy(struct cv *);
 
+
+#if OPT_A1
+/*
+ * Reader-writer lock.
+ *
+ * Operations:
+ *    rw_rlock  - Get the lock shared. Any number of readers may hold it
+ *                at once, but not while a writer does.
+ *    rw_wlock  - Get the lock exclusive.
+ *    rw_unlock - Release the lock, whichever way the current thread
+ *                holds it.
+ *
+ * With prefer_writer set at creation, waiting writers go ahead of any
+ * reader that hasn't already got in; otherwise readers keep coming in
+ * as long as another reader holds the lock. Either way, when readers
+ * get their turn every waiting reader is let in together.
+ *
+ * As with locks, the releasing thread hands the lock straight to the
+ * waiters it lets in, so nobody wakes up only to go back to sleep.
+ *
+ * The name field is for easier debugging. A copy of the name is made
+ * internally.
+ */
+
+struct rwlock {
+    char *name;
+    int prefer_writer;
+
+    volatile int readers;           // readers holding the lock
+    volatile int rwaiting;          // readers asleep on the rwlock itself
+    volatile int wwaiting;          // writers asleep on &writer
+    volatile struct thread *writer; // writer holding the lock, or NULL
+};
+
+struct rwlock *rwlock_create(const char *name, int prefer_writer);
+void           rw_rlock(struct rwlock *);
+void           rw_wlock(struct rwlock *);
+void           rw_unlock(struct rwlock *);
+void           rwlock_destroy(struct rwlock *);
+#endif // OPT_A1
+
+#if OPT_A1
+/*
+ * Adaptive mutex.
+ *
+ * Operations:
+ *    mutex_lock      - Get the mutex. If it's free this is a single
+ *                      compare-and-swap on the owner word, with no spl
+ *                      change. Otherwise spin for a bounded time while
+ *                      the owner is running on another processor (never
+ *                      the case on this uniprocessor kernel, where the
+ *                      spin is compiled out), then sleep until it is
+ *                      handed over.
+ *    mutex_unlock    - Release the mutex. Also a single compare-and-swap
+ *                      unless somebody is asleep waiting for it, in which
+ *                      case the oldest waiter is made the owner directly.
+ *    mutex_do_i_hold - Return true if the current thread holds the mutex.
+ *
+ * Unlike struct lock, a mutex may not be re-acquired by its owner and
+ * does no priority inheritance. Meant for short critical sections.
+ *
+ * The name field is for easier debugging. A copy of the name is made
+ * internally.
+ */
+
+struct mutex {
+    char *name;
+
+    // Owning thread, with MUTEX_WAITERS or'd in if anyone is asleep on it
+    volatile u_int32_t owner;
+};
+
+// Bits in the owner word (threads are at least word aligned)
+#define MUTEX_WAITERS   0x1
+#define MUTEX_OWNER(o)  ((struct thread *)((o) & ~MUTEX_WAITERS))
+
+struct mutex *mutex_create(const char *name);
+void          mutex_lock(struct mutex *);
+void          mutex_unlock(struct mutex *);
+int           mutex_do_i_hold(struct mutex *);
+void          mutex_destroy(struct mutex *);
+#endif // OPT_A1
+
+#if OPT_A1
+/*
+ * Barrier.
+ *
+ * Operations:
+ *    barrier_wait - Wait until all NTHREADS threads given at creation have
+ *                   called barrier_wait, then let them all go together.
+ *                   Returns 1 in exactly one of them (the last to arrive)
+ *                   and 0 in the rest, so one thread can do any work that
+ *                   comes between phases.
+ *
+ * The barrier resets itself as it opens, so the same threads can use it
+ * again for their next phase. A generation counter keeps a thread that
+ * races ahead into the next phase from being let through early.
+ *
+ * The name field is for easier debugging. A copy of the name is made
+ * internally.
+ */
+
+struct barrier {
+    char *name;
+    int nthreads;
+    volatile int arrived;           // threads waiting in this generation
+    volatile unsigned generation;   // times the barrier has opened
+};
+
+struct barrier *barrier_create(const char *name, int nthreads);
+int             barrier_wait(struct barrier *);
+void            barrier_destroy(struct barrier *);
+
+
+/*
+ * Countdown latch.
+ *
+ * Operations:
+ *    latch_countdown - Decrement the count. When it reaches zero, every
+ *                      waiting thread is released at once.
+ *    latch_wait      - Wait until the count is zero (at once if it is).
+ *
+ * A latch is used once; it doesn't reset.
+ *
+ * The name field is for easier debugging. A copy of the name is made
+ * internally.
+ */
+
+struct latch {
+    char *name;
+    volatile int count;
+};
+
+struct latch *latch_create(const char *name, int count);
+void          latch_countdown(struct latch *);
+void          latch_wait(struct latch *);
+void          latch_destroy(struct latch *);
+#endif // OPT_A1
+
 #endif /* _SYNCH_H_ */
@@ -11,7 +11,13 @@
  */
 
 #if OPT_A2
-pid_t sys_fork(struct trapframe *);
+int sys_fork(struct trapframe *tf, pid_t *retval);
+int sys_futex_wait(userptr_t uaddr, int expected);
+int sys_futex_wake(userptr_t uaddr, int n, int32_t *retval);
+int sys_spawn(userptr_t path, userptr_t argv, pid_t *retval);
+void sys__exit(int exitcode);
+int sys_waitpid(pid_t pid, userptr_t status, int options, pid_t *retval);
+int sys___time(userptr_t secs, userptr_t nsecs, int32_t *retval);
 #endif // OPT_A2
 int sys_reboot(int code);
 
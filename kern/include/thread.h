@@ -8,8 +8,32 @@
 /* Get machine-dependent stuff */
 #include <machine/pcb.h>
 
+#include "opt-A1.h"
+#include "opt-A2.h"
+#include "opt-mlfq.h"
+#include "opt-stride.h"
+
+#if OPT_A1
+#include <timeout.h>
+#endif // OPT_A1
 
 struct addrspace;
+#if OPT_A2
+struct process;
+#endif // OPT_A2
+#if OPT_MLFQ
+struct lock;
+#endif // OPT_MLFQ
+#if OPT_A1
+struct wchan;
+
+/* Names up to this long are stored in the thread itself. */
+#define THREAD_NAMELEN      32
+
+/* Default watermarks for the cache of dead threads and their stacks. */
+#define THREAD_CACHE_LOWAT  16
+#define THREAD_CACHE_HIWAT  64
+#endif // OPT_A1
 
 struct thread {
 	/**********************************************************/
@@ -20,6 +44,37 @@ struct thread {
 	char *t_name;
 	const void *t_sleepaddr;
 	char *t_stack;
+#if OPT_A1
+	struct wchan *t_wchan;       /* wchan we own while awake, else NULL */
+	struct wchan *t_sleepchan;   /* wait channel we're asleep on */
+	struct thread *t_wqnext;     /* links in the wait channel's FIFO */
+	struct thread *t_wqprev;
+	char t_namebuf[THREAD_NAMELEN];
+	int t_joinable;              /* kept after exit until thread_join */
+	volatile int t_exited;       /* has been through thread_exit */
+	int t_exitval;               /* value passed to thread_exit */
+	struct timeout t_timeout;    /* for timed sleeps */
+	int t_timedout;              /* last timed sleep ran out */
+#endif // OPT_A1
+#if OPT_MLFQ
+	/* Owned by the scheduler */
+	int t_priority;              /* MLFQ level, 0 is highest */
+	int t_ticks;                 /* ticks used of the current quantum */
+	unsigned t_epoch;            /* last priority boost we've seen */
+	struct thread *t_rqnext;     /* links in the run queue FIFO */
+	struct thread *t_rqprev;
+	int t_rqpri;                 /* FIFO we're queued on, -1 if none */
+	int t_donated;               /* inherited priority, or PRI_NONE */
+	struct lock *t_blockedon;    /* lock we're waiting for */
+	struct lock *t_heldlocks;    /* locks we own, via lock->next_held */
+#endif // OPT_MLFQ
+#if OPT_STRIDE
+	/* Owned by the scheduler */
+	unsigned t_tickets;          /* share of the CPU we're entitled to */
+	u_int32_t t_stride;          /* STRIDE1 / t_tickets */
+	u_int64_t t_pass;            /* virtual time we've used up to */
+	unsigned t_runticks;         /* clock ticks actually run */
+#endif // OPT_STRIDE
 	
 	/**********************************************************/
 	/* Public thread members - can be used by other code      */
@@ -37,6 +92,14 @@ struct thread {
 	 * and is manipulated by the virtual filesystem (VFS) code.
 	 */
 	struct vnode *t_cwd;
+#if OPT_A2
+
+	/*
+	 * The process this thread belongs to. Inherited by new threads;
+	 * set by the process code (see proc.c).
+	 */
+	struct process *t_proc;
+#endif // OPT_A2
 };
 
 /* Call once during startup to allocate data structures. */
@@ -63,12 +126,58 @@ int thread_fork(const char *name,
 		void (*func)(void *, unsigned long),
 		struct thread **ret);
 
+#if OPT_A1
+/*
+ * Like thread_fork, but makes a joinable thread. Its structure stays
+ * valid after it exits, until the handle returned in "ret" (which must
+ * be non-null) is passed to thread_join.
+ */
+int thread_fork_joinable(const char *name,
+			 void *data1, unsigned long data2,
+			 void (*func)(void *, unsigned long),
+			 struct thread **ret);
+
+/*
+ * Make N new threads at once, all named "name" and starting at "func".
+ * Thread i is passed "data1" and i. All the allocation is done first
+ * and the threads are then made runnable as one batch, so either all
+ * of them start or (on error) none do. If "rets" is non-null it must
+ * have room for N entries, and receives the new thread structures
+ * (with the same caveat as for thread_fork). If "joinable" is set, the
+ * threads are joinable as with thread_fork_joinable, and "rets" is
+ * required. Returns an error code.
+ */
+int thread_fork_many(const char *name, int n,
+		     void *data1,
+		     void (*func)(void *, unsigned long),
+		     int joinable,
+		     struct thread **rets);
+#endif // OPT_A1
+
 /*
  * Cause the current thread to exit.
  * Interrupts need not be disabled.
  */
 void thread_exit(void);
 
+#if OPT_A1
+/*
+ * Like thread_exit, but with an exit value for thread_join to report.
+ * (thread_exit() exits with 0.)
+ */
+void thread_exit_value(int exitval);
+#endif // OPT_A1
+
+#if OPT_A1
+/*
+ * Wait for the joinable thread "t" to exit, and then destroy it. Its
+ * exit value is stored in *exitval if exitval is non-null. Returns
+ * EINVAL if "t" isn't joinable or is the current thread.
+ * Interrupts need not be disabled.
+ */
+int thread_join(struct thread *t, int *exitval);
+#endif // OPT_A1
+
 /*
  * Cause the current thread to yield to the next runnable thread, but
  * itself stay runnable.
@@ -90,9 +199,56 @@ void thread_sleep(const void *addr);
  */
 void thread_wakeup(const void *addr);
 
+#if OPT_A1
+/*
+ * Sleep until clock_ticks() reaches WHEN. Returns immediately if it
+ * already has. Interrupts need not be disabled.
+ */
+void thread_sleep_until(u_int32_t when);
+
+/*
+ * Like thread_sleep(), but wake up on our own after NTICKS clock ticks.
+ * Returns nonzero if that is what happened. Interrupts must be disabled.
+ */
+int thread_sleep_timeout(const void *addr, int nticks);
+
+/*
+ * Wake only the oldest thread sleeping on the specified address, and
+ * return it (NULL if there was none). Interrupts must be disabled.
+ */
+struct thread *thread_wakeup_one(const void *addr);
+#endif // OPT_A1
+
+#if OPT_A1 && OPT_MLFQ
+/*
+ * Wake the thread sleeping on the specified address that has the best
+ * effective priority (the oldest of them on a tie), and return it (NULL
+ * if there was none). Interrupts must be disabled.
+ */
+struct thread *thread_wakeup_top(const void *addr);
+
+/*
+ * Return the best effective priority of the threads sleeping on the
+ * specified address (PRI_NONE if there are none). Interrupts must be
+ * disabled.
+ */
+int thread_sleepers_toppri(const void *addr);
+#endif // OPT_A1 && OPT_MLFQ
+
+#if OPT_A1
+/*
+ * Return nonzero if thread T is running on a processor at the moment
+ * (as opposed to runnable, asleep or exited). On this uniprocessor
+ * kernel that is true only of the current thread.
+ */
+int thread_oncpu(const struct thread *t);
+#endif // OPT_A1
+
 /*
  * Return nonzero if there are any threads sleeping on the specified
  * address. Meant only for diagnostic purposes.
+ * (Under OPT_A1 this is O(1) and the nonzero value is the number of
+ * sleepers.)
  */
 int thread_hassleepers(const void *addr);
 
@@ -121,6 +277,22 @@ int thread_hassleepers(const void *addr);
  */
 int one_thread_only(void);
 
+#if OPT_A1
+/*
+ * Tune and report on the cache of dead threads that thread_fork()
+ * recycles. Exited threads are cached (stack included) up to HIWAT;
+ * past that the cache is trimmed down to LOWAT.
+ */
+int thread_cache_setwat(int lowat, int hiwat);
+void thread_cache_stats(void);
+
+/*
+ * Kernel menu command: "threadcache" prints the cache statistics,
+ * "threadcache LOWAT HIWAT" sets the watermarks.
+ */
+int cmd_threadcache(int nargs, char **args);
+#endif // OPT_A1
+
 /*
  * Private thread functions.
  */
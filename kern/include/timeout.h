@@ -0,0 +1,58 @@
+#ifndef _TIMEOUT_H_
+#define _TIMEOUT_H_
+
+/*
+ * Kernel timeouts, kept on a hierarchical timer wheel driven by
+ * hardclock().
+ *
+ *     timeout_set     - initialize a timeout to call FUNC(ARG) when it
+ *                       expires. Must be done before anything else.
+ *     timeout_add     - arm the timeout to expire TICKS clock ticks
+ *                       from now (at least one). Re-arms it if pending.
+ *     timeout_add_at  - arm the timeout to expire at the absolute tick
+ *                       count WHEN (or on the next tick, if WHEN has
+ *                       already passed).
+ *     timeout_del     - cancel the timeout. Returns nonzero if it was
+ *                       still pending, 0 if it had already fired or was
+ *                       never armed.
+ *     timeout_pending - nonzero if the timeout is armed.
+ *
+ *     clock_ticks     - number of clock ticks (HZ per second) since boot.
+ *                       Wraps; compare tick counts by their difference.
+ *     clock_uptime    - time since boot, as whole seconds plus ticks into
+ *                       the current second. Consistent without needing
+ *                       interrupts off (see seqlock.h).
+ *     clock_uptime_spl - the same, read with interrupts off instead.
+ *     clock_uptime_touch - an empty write to the uptime. These two are
+ *                       only for uptimebench.
+ *     timeout_tick    - advance the clock one tick and run whatever has
+ *                       expired. Called only from hardclock().
+ *
+ * Expiry functions are called from the clock interrupt with interrupts
+ * off, so they must not sleep. Waking threads up is fine.
+ *
+ * The struct timeout is owned by the caller (typically embedded in
+ * something else), so arming one never allocates.
+ */
+
+struct timeout {
+	struct timeout *to_next;     /* links in the wheel slot */
+	struct timeout **to_pprev;   /* NULL when not pending */
+	u_int32_t to_time;           /* tick count to expire at */
+	void (*to_func)(void *);
+	void *to_arg;
+};
+
+void timeout_set(struct timeout *to, void (*func)(void *), void *arg);
+void timeout_add(struct timeout *to, int ticks);
+void timeout_add_at(struct timeout *to, u_int32_t when);
+int timeout_del(struct timeout *to);
+int timeout_pending(struct timeout *to);
+
+u_int32_t clock_ticks(void);
+void clock_uptime(u_int32_t *secs, u_int32_t *nticks);
+void clock_uptime_spl(u_int32_t *secs, u_int32_t *nticks);
+void clock_uptime_touch(void);
+void timeout_tick(void);
+
+#endif /* _TIMEOUT_H_ */
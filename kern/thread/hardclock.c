@@ -0,0 +1,70 @@
+#include <types.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <thread.h>
+#include <scheduler.h>
+#include <clock.h>
+#include <timeout.h>
+#include "opt-A1.h"
+
+/*
+ * The address of lbolt has thread_wakeup called on it once a second.
+ */
+static int lbolt;
+
+static int lbolt_counter;
+
+/*
+ * This is called HZ times a second by the timer device setup.
+ */
+
+void
+hardclock(void)
+{
+	/*
+	 * Collect statistics here as desired.
+	 */
+
+	lbolt_counter++;
+	if (lbolt_counter >= HZ) {
+		lbolt_counter = 0;
+		thread_wakeup(&lbolt);
+	}
+
+	/*
+	 * Advance the tick count and run any timeouts that are due.
+	 */
+	timeout_tick();
+
+	/*
+	 * Let the scheduler charge the tick and decide whether the
+	 * current thread should give up the CPU. (Round robin always
+	 * says yes.)
+	 */
+	if (scheduler_tick()) {
+		thread_yield();
+	}
+}
+
+/*
+ * Suspend execution for n seconds.
+ */
+void
+clocksleep(int num_secs)
+{
+#if OPT_A1
+	/* Sleeps exactly num_secs from now, not until the num_secs'th lbolt. */
+	if (num_secs > 0) {
+		thread_sleep_until(clock_ticks() + num_secs * HZ);
+	}
+#else
+	int s;
+
+	s = splhigh();
+	while (num_secs > 0) {
+		thread_sleep(&lbolt);
+		num_secs--;
+	}
+	splx(s);
+#endif // OPT_A1
+}
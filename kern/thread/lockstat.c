@@ -0,0 +1,232 @@
+/*
+ * Lock contention statistics. Only compiled in with "options lockstat".
+ * See lockstat.h.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <lockstat.h>
+
+/* All the records, newest first, and how many were allocated */
+static struct lockstat *lockstat_list;
+static int lockstat_nrecs;
+
+/* Shared records for names past LOCKSTAT_MAXRECS, one per kind */
+static struct lockstat lockstat_other[LOCKSTAT_CV+1];
+
+static const char *const lockstat_kinds[] = { "sem", "lock", "cv" };
+
+/*
+ * Look up the record for NAME and KIND. Interrupts must be off.
+ */
+static
+struct lockstat *
+lockstat_find(const char *name, int kind)
+{
+	struct lockstat *ls;
+
+	for (ls = lockstat_list; ls != NULL; ls = ls->ls_next) {
+		if (ls->ls_kind == kind && !strcmp(ls->ls_name, name)) {
+			return ls;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Clear LS's counters and put it on the list. Interrupts must be off.
+ */
+static
+void
+lockstat_link(struct lockstat *ls, int kind)
+{
+	bzero(ls->ls_holdhist, sizeof(ls->ls_holdhist));
+	ls->ls_kind = kind;
+	ls->ls_acquires = ls->ls_contended = 0;
+	ls->ls_waitticks = ls->ls_waitmax = 0;
+	ls->ls_releases = ls->ls_wakeups = 0;
+	ls->ls_next = lockstat_list;
+	lockstat_list = ls;
+}
+
+/*
+ * The record every further NAME of this KIND shares once the table is
+ * full. Interrupts must be off.
+ */
+static
+struct lockstat *
+lockstat_overflow(int kind)
+{
+	struct lockstat *ls = &lockstat_other[kind];
+
+	if (ls->ls_name == NULL) {
+		ls->ls_name = (char *)"(other)";
+		lockstat_link(ls, kind);
+	}
+	return ls;
+}
+
+struct lockstat *
+lockstat_get(const char *name, int kind)
+{
+	struct lockstat *ls, *new;
+	int spl;
+
+	assert(kind >= LOCKSTAT_SEM && kind <= LOCKSTAT_CV);
+
+	spl = splhigh();
+	ls = lockstat_find(name, kind);
+	if (ls == NULL && lockstat_nrecs >= LOCKSTAT_MAXRECS) {
+		ls = lockstat_overflow(kind);
+	}
+	splx(spl);
+	if (ls != NULL) {
+		return ls;
+	}
+
+	/*
+	 * A new name. Allocate with interrupts back on, so the rest of
+	 * the system isn't held up while kmalloc works; that means looking
+	 * again afterwards, in case somebody added the name meanwhile.
+	 */
+	new = kmalloc(sizeof(struct lockstat));
+	if (new == NULL) {
+		return NULL;
+	}
+	new->ls_name = kstrdup(name);
+	if (new->ls_name == NULL) {
+		kfree(new);
+		return NULL;
+	}
+
+	spl = splhigh();
+	ls = lockstat_find(name, kind);
+	if (ls == NULL && lockstat_nrecs >= LOCKSTAT_MAXRECS) {
+		ls = lockstat_overflow(kind);
+	}
+	if (ls == NULL) {
+		lockstat_link(new, kind);
+		lockstat_nrecs++;
+		ls = new;
+		new = NULL;
+	}
+	splx(spl);
+
+	if (new != NULL) {
+		kfree(new->ls_name);
+		kfree(new);
+	}
+	return ls;
+}
+
+void
+lockstat_acquired(struct lockstat *ls, int contended, u_int32_t waited)
+{
+	int spl;
+
+	if (ls == NULL) {
+		return;
+	}
+
+	spl = splhigh();
+	ls->ls_acquires++;
+	if (contended) {
+		ls->ls_contended++;
+		ls->ls_waitticks += waited;
+		if (waited > ls->ls_waitmax) {
+			ls->ls_waitmax = waited;
+		}
+	}
+	splx(spl);
+}
+
+void
+lockstat_released(struct lockstat *ls, int wakeups, u_int32_t held)
+{
+	int spl, b;
+
+	if (ls == NULL) {
+		return;
+	}
+
+	/* Bucket b holds 2^(b-1) .. 2^b - 1 ticks; the last one the rest */
+	for (b = 0; b < LOCKSTAT_NHIST-1 && held >= (1U << b); b++) {
+		/* nothing */
+	}
+
+	spl = splhigh();
+	ls->ls_releases++;
+	ls->ls_wakeups += wakeups;
+	if (ls->ls_kind == LOCKSTAT_LOCK) {
+		ls->ls_holdhist[b]++;
+	}
+	splx(spl);
+}
+
+/*
+ * Print the table. Interrupts stay on while printing (the console is
+ * slow); a record that changes part way through prints a little off.
+ */
+void
+lockstat_dump(void)
+{
+	struct lockstat *ls;
+	int b;
+
+	kprintf("%-4s %-24s %8s %8s %8s %6s %8s %8s\n",
+		"kind", "name", "acquire", "contend", "waitsum", "waitmx",
+		"release", "wakeups");
+
+	for (ls = lockstat_list; ls != NULL; ls = ls->ls_next) {
+		if (ls->ls_acquires == 0 && ls->ls_releases == 0) {
+			continue;
+		}
+		kprintf("%-4s %-24s %8u %8u %8u %6u %8u %8u\n",
+			lockstat_kinds[ls->ls_kind], ls->ls_name,
+			ls->ls_acquires, ls->ls_contended,
+			ls->ls_waitticks, ls->ls_waitmax,
+			ls->ls_releases, ls->ls_wakeups);
+		if (ls->ls_kind == LOCKSTAT_LOCK) {
+			kprintf("     hold ticks 0/1/2+/4+/8+/16+/32+/64+:");
+			for (b = 0; b < LOCKSTAT_NHIST; b++) {
+				kprintf(" %u", ls->ls_holdhist[b]);
+			}
+			kprintf("\n");
+		}
+	}
+}
+
+void
+lockstat_reset(void)
+{
+	struct lockstat *ls;
+	int spl = splhigh();
+
+	for (ls = lockstat_list; ls != NULL; ls = ls->ls_next) {
+		ls->ls_acquires = ls->ls_contended = 0;
+		ls->ls_waitticks = ls->ls_waitmax = 0;
+		ls->ls_releases = ls->ls_wakeups = 0;
+		bzero(ls->ls_holdhist, sizeof(ls->ls_holdhist));
+	}
+	splx(spl);
+}
+
+/*
+ * Menu command.
+ */
+int
+cmd_lockstat(int nargs, char **args)
+{
+	if (nargs == 1) {
+		lockstat_dump();
+		return 0;
+	}
+	if (nargs == 2 && !strcmp(args[1], "reset")) {
+		lockstat_reset();
+		return 0;
+	}
+	kprintf("Usage: lockstat [reset]\n");
+	return EINVAL;
+}
@@ -0,0 +1,130 @@
+/*
+ * Lock-free multi-producer, single-consumer queue. See mpscq.h.
+ *
+ * The list runs from mq_tail (oldest) to mq_head (newest) through
+ * mn_next. A producer swaps its node into mq_head and only then links
+ * the previous head to it, so for a moment the list can be broken just
+ * before the newest node; the consumer treats that as "nothing yet".
+ * The stub node is pushed back whenever the consumer is about to take
+ * the last real node, so the list is never empty and producers never
+ * need to touch mq_tail.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <atomic.h>
+#include <thread.h>
+#include <mpscq.h>
+
+void
+mpscq_init(struct mpscq *q)
+{
+	q->mq_stub.mn_next = NULL;
+	q->mq_head = &q->mq_stub;
+	q->mq_tail = &q->mq_stub;
+	q->mq_sleeping = 0;
+}
+
+/*
+ * Link NODE in at the head. No wakeup.
+ */
+static
+void
+mpscq_link(struct mpscq *q, struct mpscq_node *node)
+{
+	struct mpscq_node *prev;
+
+	node->mn_next = NULL;
+	prev = atomic_swap_ptr(&q->mq_head, node);
+	/* The list is broken between prev and node until this store. */
+	prev->mn_next = node;
+}
+
+void
+mpscq_push(struct mpscq *q, struct mpscq_node *node)
+{
+	mpscq_link(q, node);
+
+	/*
+	 * The consumer sets mq_sleeping before its last look at the
+	 * queue, so if it's clear here the consumer will see our node.
+	 */
+	membar();
+	if (q->mq_sleeping) {
+		int spl = splhigh();
+		thread_wakeup(q);
+		splx(spl);
+	}
+}
+
+struct mpscq_node *
+mpscq_pop(struct mpscq *q)
+{
+	struct mpscq_node *tail = q->mq_tail;
+	struct mpscq_node *next = tail->mn_next;
+
+	/* Step over the stub. */
+	if (tail == &q->mq_stub) {
+		if (next == NULL) {
+			return NULL;
+		}
+		q->mq_tail = next;
+		tail = next;
+		next = next->mn_next;
+	}
+
+	if (next != NULL) {
+		q->mq_tail = next;
+		return tail;
+	}
+
+	/* tail looks like the last node. Is it really? */
+	if (tail != q->mq_head) {
+		/* A producer is mid-push behind it. */
+		return NULL;
+	}
+
+	/* Put the stub back behind it, so we can take it. */
+	mpscq_link(q, &q->mq_stub);
+	next = tail->mn_next;
+	if (next != NULL) {
+		q->mq_tail = next;
+		return tail;
+	}
+	return NULL;
+}
+
+struct mpscq_node *
+mpscq_wait(struct mpscq *q)
+{
+	struct mpscq_node *node;
+	int spl;
+
+	assert(in_interrupt==0);
+
+	for (;;) {
+		node = mpscq_pop(q);
+		if (node != NULL) {
+			return node;
+		}
+
+		/*
+		 * Say we're going to sleep, then look once more, with
+		 * interrupts off so no wakeup can slip in between.
+		 */
+		spl = splhigh();
+		q->mq_sleeping = 1;
+		membar();
+		node = mpscq_pop(q);
+		if (node == NULL) {
+			thread_sleep(q);
+		}
+		q->mq_sleeping = 0;
+		splx(spl);
+
+		if (node != NULL) {
+			return node;
+		}
+	}
+}
@@ -0,0 +1,966 @@
+/*
+ * Scheduler.
+ *
+ * The default scheduler is very simple, just a round-robin run queue.
+ * You'll want to improve it.
+ *
+ * With "options mlfq" a multi-level feedback queue is used instead:
+ * threads that use up their quantum sink to lower priority levels,
+ * threads that go to sleep on their own float back up, and everybody
+ * is boosted back to the top level periodically so that CPU-bound
+ * threads can't be starved outright.
+ *
+ * With "options stride" CPU time is shared out in proportion to each
+ * thread's tickets instead, using stride scheduling.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <kern/errno.h>
+#include <scheduler.h>
+#include <thread.h>
+#include <curthread.h>
+#include <clock.h>
+#include <machine/spl.h>
+#include <queue.h>
+#include <array.h>
+
+#include "opt-mlfq.h"
+#include "opt-stride.h"
+
+#if OPT_MLFQ && OPT_STRIDE
+#error "options mlfq and options stride are mutually exclusive"
+#endif
+
+#if OPT_MLFQ
+
+/*
+ * Priority run queue.
+ *
+ * One FIFO per priority, linked through t_rqnext so nothing is ever
+ * allocated, plus a bitmap with bit P set when FIFO P is nonempty.
+ * Priority 0 is the highest, so the next thread to run is at the head
+ * of the FIFO for the lowest set bit. Enqueue, dequeue and picking the
+ * highest priority are all O(1) however many threads are runnable.
+ *
+ * (lib/bitmap.c doesn't fit here: it is byte-at-a-time and only knows
+ * how to find a clear bit. 32 priorities fit in one word.)
+ */
+#define RQ_NPRIO	32
+
+struct runqueue {
+	struct thread *rq_head[RQ_NPRIO];
+	struct thread *rq_tail[RQ_NPRIO];
+	u_int32_t rq_bitmap;
+};
+
+/*
+ * Index of the lowest set bit of nonzero X, by de Bruijn multiply; the
+ * MIPS-I core has no count-leading/trailing-zeros instruction.
+ */
+static const unsigned char rq_debruijn[32] = {
+	0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+	31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+static
+int
+rq_ffs(u_int32_t x)
+{
+	assert(x != 0);
+	return rq_debruijn[((x & -x) * 0x077CB531U) >> 27];
+}
+
+static
+void
+rq_init(struct runqueue *rq)
+{
+	int i;
+
+	for (i=0; i<RQ_NPRIO; i++) {
+		rq->rq_head[i] = rq->rq_tail[i] = NULL;
+	}
+	rq->rq_bitmap = 0;
+}
+
+static
+int
+rq_empty(struct runqueue *rq)
+{
+	return rq->rq_bitmap == 0;
+}
+
+/* Add T at the tail of the FIFO for priority PRI. */
+static
+void
+rq_add(struct runqueue *rq, struct thread *t, int pri)
+{
+	assert(pri >= 0 && pri < RQ_NPRIO);
+
+	t->t_rqnext = NULL;
+	t->t_rqprev = rq->rq_tail[pri];
+	if (rq->rq_tail[pri] != NULL) {
+		rq->rq_tail[pri]->t_rqnext = t;
+	}
+	else {
+		rq->rq_head[pri] = t;
+		rq->rq_bitmap |= (u_int32_t)1 << pri;
+	}
+	rq->rq_tail[pri] = t;
+}
+
+/* Take T off the FIFO for priority PRI, wherever it is in it. */
+static
+void
+rq_remove(struct runqueue *rq, struct thread *t, int pri)
+{
+	if (t->t_rqprev != NULL) {
+		t->t_rqprev->t_rqnext = t->t_rqnext;
+	}
+	else {
+		rq->rq_head[pri] = t->t_rqnext;
+	}
+	if (t->t_rqnext != NULL) {
+		t->t_rqnext->t_rqprev = t->t_rqprev;
+	}
+	else {
+		rq->rq_tail[pri] = t->t_rqprev;
+	}
+	if (rq->rq_head[pri] == NULL) {
+		rq->rq_bitmap &= ~((u_int32_t)1 << pri);
+	}
+	t->t_rqnext = t->t_rqprev = NULL;
+}
+
+/* Highest priority that has a runnable thread. Queue must be nonempty. */
+static
+int
+rq_toppri(struct runqueue *rq)
+{
+	return rq_ffs(rq->rq_bitmap);
+}
+
+/* Take the head of the highest nonempty FIFO. */
+static
+struct thread *
+rq_remhighest(struct runqueue *rq)
+{
+	int pri = rq_toppri(rq);
+	struct thread *t = rq->rq_head[pri];
+
+	rq_remove(rq, t, pri);
+	return t;
+}
+
+/* Append the whole FIFO for priority FROM to the one for priority TO. */
+static
+void
+rq_splice(struct runqueue *rq, int from, int to)
+{
+	if (rq->rq_head[from] == NULL) {
+		return;
+	}
+	if (rq->rq_tail[to] != NULL) {
+		rq->rq_tail[to]->t_rqnext = rq->rq_head[from];
+		rq->rq_head[from]->t_rqprev = rq->rq_tail[to];
+	}
+	else {
+		rq->rq_head[to] = rq->rq_head[from];
+		rq->rq_bitmap |= (u_int32_t)1 << to;
+	}
+	rq->rq_tail[to] = rq->rq_tail[from];
+	rq->rq_head[from] = rq->rq_tail[from] = NULL;
+	rq->rq_bitmap &= ~((u_int32_t)1 << from);
+}
+
+/*
+ *  Scheduler data
+ */
+
+/* Number of priority levels. Level 0 is the highest. */
+#define MLFQ_LEVELS	4
+
+/* Quantum, in clock ticks, of a thread running at level L. */
+#define MLFQ_QUANTUM(l)	(1 << (l))
+
+/* Ticks between boosts of every thread back to level 0. */
+#define MLFQ_BOOST	HZ
+
+// Runnable threads, indexed by level
+static struct runqueue runqueue;
+
+// Ticks until the next boost
+static int boost_countdown;
+
+// Cleared by scheduler_setboost() to hold boosts off, for testing
+static int boost_enabled;
+
+/*
+ * Boost epoch. Bumped on every boost; a thread whose t_epoch is stale
+ * has been boosted (or slept through a boost) and belongs at level 0.
+ * This lets a boost just splice the queues together instead of
+ * visiting every thread.
+ */
+static unsigned boost_epoch;
+
+/*
+ * Priority a thread actually runs at: its own MLFQ level, or whatever
+ * has been donated to it through priority inheritance, if better.
+ */
+#define MLFQ_EFFPRI(t) \
+	((t)->t_donated < (t)->t_priority ? (t)->t_donated : (t)->t_priority)
+
+/*
+ * FIFO a queued thread is on. A boost moves every queued thread to
+ * level 0 without touching it, which we can tell from its stale epoch.
+ */
+#define MLFQ_QUEUEDAT(t) \
+	((t)->t_epoch != boost_epoch ? 0 : (t)->t_rqpri)
+
+/*
+ * Put T back at level 0 if a boost has happened since it last ran.
+ */
+static
+void
+mlfq_catchup(struct thread *t)
+{
+	if (t->t_epoch != boost_epoch) {
+		t->t_priority = 0;
+		t->t_ticks = 0;
+		t->t_epoch = boost_epoch;
+	}
+}
+
+/*
+ * Setup function
+ */
+void
+scheduler_bootstrap(void)
+{
+	assert(MLFQ_LEVELS <= RQ_NPRIO);
+	rq_init(&runqueue);
+	boost_countdown = MLFQ_BOOST;
+	boost_enabled = 1;
+	boost_epoch = 0;
+}
+
+/*
+ * The run queue is linked through the threads themselves, so there
+ * is nothing to preallocate.
+ */
+int
+scheduler_preallocate(int nthreads)
+{
+	assert(curspl>0);
+	(void)nthreads;
+	return 0;
+}
+
+/*
+ * This is called during panic shutdown to dispose of threads other
+ * than the one invoking panic. We drop them on the floor instead of
+ * cleaning them up properly; since we're about to go down it doesn't
+ * really matter, and freeing everything might cause further panics.
+ */
+void
+scheduler_killall(void)
+{
+	assert(curspl>0);
+	while (!rq_empty(&runqueue)) {
+		struct thread *t = rq_remhighest(&runqueue);
+		t->t_rqpri = -1;
+		kprintf("scheduler: Dropping thread %s.\n", t->t_name);
+	}
+}
+
+/*
+ * Cleanup function.
+ */
+void
+scheduler_shutdown(void)
+{
+	scheduler_killall();
+
+	assert(curspl>0);
+	rq_init(&runqueue);
+}
+
+/*
+ * Move every runnable thread to level 0 and start a new epoch.
+ */
+static
+void
+mlfq_boost(void)
+{
+	int i;
+
+	for (i=1; i<MLFQ_LEVELS; i++) {
+		rq_splice(&runqueue, i, 0);
+	}
+	boost_epoch++;
+
+	if (curthread != NULL) {
+		mlfq_catchup(curthread);
+	}
+}
+
+/*
+ * Actual scheduler. Returns the next thread to run.  Calls cpu_idle()
+ * if there's nothing ready. (Note: cpu_idle must be called in a loop
+ * until something's ready - it doesn't know whether the things that
+ * wake it up are going to make a thread runnable or not.)
+ *
+ * Picks the head of the highest nonempty level.
+ */
+struct thread *
+scheduler(void)
+{
+	struct thread *t;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	while (rq_empty(&runqueue)) {
+		cpu_idle();
+	}
+
+	t = rq_remhighest(&runqueue);
+	t->t_rqpri = -1;
+	mlfq_catchup(t);
+	return t;
+}
+
+/*
+ * Make a thread runnable, at the tail of its level.
+ */
+int
+make_runnable(struct thread *t)
+{
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	mlfq_catchup(t);
+	t->t_rqpri = MLFQ_EFFPRI(t);
+	rq_add(&runqueue, t, t->t_rqpri);
+	return 0;
+}
+
+/*
+ * Charge a clock tick to the current thread. Demote it if it has used up
+ * its quantum, and ask for a reschedule if it has, or if anything of
+ * higher priority is waiting.
+ */
+int
+scheduler_tick(void)
+{
+	struct thread *t = curthread;
+
+	// called from hardclock, with interrupts off
+	assert(curspl>0);
+
+	if (boost_enabled && --boost_countdown <= 0) {
+		boost_countdown = MLFQ_BOOST;
+		mlfq_boost();
+	}
+
+	/* In the idle loop; let thread_yield sort it out. */
+	if (t == NULL) {
+		return 1;
+	}
+
+	t->t_ticks++;
+	if (t->t_ticks >= MLFQ_QUANTUM(t->t_priority)) {
+		if (t->t_priority < MLFQ_LEVELS-1) {
+			t->t_priority++;
+		}
+		t->t_ticks = 0;
+		/*
+		 * The new level is as of this epoch; don't let a stale
+		 * t_epoch send the thread back to level 0 on requeue.
+		 */
+		t->t_epoch = boost_epoch;
+		return 1;
+	}
+
+	return !rq_empty(&runqueue) && rq_toppri(&runqueue) < MLFQ_EFFPRI(t);
+}
+
+/*
+ * A thread giving up the CPU on its own is probably interactive or
+ * waiting on I/O or a lock; move it up a level.
+ */
+void
+scheduler_block(struct thread *t)
+{
+	assert(curspl>0);
+
+	if (t->t_priority > 0) {
+		t->t_priority--;
+	}
+	t->t_ticks = 0;
+}
+
+/*
+ * Priority inheritance: T now has PRI donated to it (PRI_NONE for no
+ * donation). If T is sitting in the run queue, move it to the FIFO for
+ * its new effective priority.
+ */
+void
+scheduler_donate(struct thread *t, int pri)
+{
+	assert(curspl>0);
+
+	if (t->t_rqpri >= 0) {
+		rq_remove(&runqueue, t, MLFQ_QUEUEDAT(t));
+		t->t_donated = pri;
+		mlfq_catchup(t);
+		t->t_rqpri = MLFQ_EFFPRI(t);
+		rq_add(&runqueue, t, t->t_rqpri);
+	}
+	else {
+		t->t_donated = pri;
+	}
+}
+
+/*
+ * Turn the periodic boost on or off; returns whether it was on. Turning
+ * it back on starts a full boost period.
+ */
+int
+scheduler_setboost(int enable)
+{
+	int spl, was;
+
+	spl = splhigh();
+	was = boost_enabled;
+	boost_enabled = enable;
+	boost_countdown = MLFQ_BOOST;
+	splx(spl);
+
+	return was;
+}
+
+/*
+ * Effective priority of T, including anything donated to it.
+ */
+int
+scheduler_priority(struct thread *t)
+{
+	return MLFQ_EFFPRI(t);
+}
+
+/*
+ * Debugging function to dump the run queues.
+ */
+void
+print_run_queue(void)
+{
+	/* Turn interrupts off so the whole list prints atomically. */
+	int spl = splhigh();
+
+	int k=0,l;
+
+	for (l=0; l<RQ_NPRIO; l++) {
+		struct thread *t;
+
+		for (t = runqueue.rq_head[l]; t != NULL; t = t->t_rqnext) {
+			kprintf("  %2d: [%d] %s %p\n", k, l, t->t_name,
+				t->t_sleepaddr);
+			k++;
+		}
+	}
+
+	splx(spl);
+}
+
+#elif OPT_STRIDE
+
+/*
+ * Stride scheduling.
+ *
+ * Each thread has a number of tickets and a stride inversely
+ * proportional to them. Every tick a thread runs advances its pass by
+ * its stride, and the runnable thread with the smallest pass runs next,
+ * so over time each thread gets CPU in proportion to its tickets.
+ * Runnable threads are kept in a binary min-heap on pass.
+ *
+ * Pass values are 64 bits. Even a one-ticket thread running flat out
+ * takes 2^44 ticks to wrap one, so they can be compared directly, and
+ * a thread that sleeps for any length of time compares correctly with
+ * global_pass when it wakes. (With 32 bits and compare-by-difference,
+ * a sleeper more than 2^31 behind looked like it was ahead.)
+ */
+
+#define STRIDE_PASS_LT(a, b)  ((a) < (b))
+
+// Min-heap of runnable threads, ordered by t_pass
+static struct array *runheap;
+
+// Pass of the thread most recently dispatched; the system's virtual time
+static u_int64_t global_pass;
+
+// Ticks charged to all threads, for working out shares
+static u_int32_t total_ticks;
+
+static
+void
+heap_set(int i, struct thread *t)
+{
+	array_setguy(runheap, i, t);
+}
+
+static
+struct thread *
+heap_get(int i)
+{
+	return array_getguy(runheap, i);
+}
+
+static
+void
+heap_siftup(int i)
+{
+	struct thread *t = heap_get(i);
+
+	while (i > 0) {
+		int parent = (i-1)/2;
+		struct thread *p = heap_get(parent);
+		if (!STRIDE_PASS_LT(t->t_pass, p->t_pass)) {
+			break;
+		}
+		heap_set(i, p);
+		i = parent;
+	}
+	heap_set(i, t);
+}
+
+static
+void
+heap_siftdown(int i)
+{
+	int n = array_getnum(runheap);
+	struct thread *t = heap_get(i);
+
+	for (;;) {
+		int child = 2*i + 1;
+		struct thread *c;
+
+		if (child >= n) {
+			break;
+		}
+		c = heap_get(child);
+		if (child+1 < n &&
+		    STRIDE_PASS_LT(heap_get(child+1)->t_pass, c->t_pass)) {
+			child++;
+			c = heap_get(child);
+		}
+		if (!STRIDE_PASS_LT(c->t_pass, t->t_pass)) {
+			break;
+		}
+		heap_set(i, c);
+		i = child;
+	}
+	heap_set(i, t);
+}
+
+static
+struct thread *
+heap_remmin(void)
+{
+	int n = array_getnum(runheap);
+	struct thread *top = heap_get(0);
+	int result;
+
+	heap_set(0, heap_get(n-1));
+	result = array_setsize(runheap, n-1);
+	/* Shrinking the array; not supposed to be able to fail. */
+	assert(result==0);
+	if (n-1 > 0) {
+		heap_siftdown(0);
+	}
+	return top;
+}
+
+/*
+ * Setup function
+ */
+void
+scheduler_bootstrap(void)
+{
+	runheap = array_create();
+	if (runheap == NULL) {
+		panic("scheduler: Could not create run queue\n");
+	}
+	global_pass = 0;
+	total_ticks = 0;
+}
+
+/*
+ * Ensure space for handling at least NTHREADS threads, so that
+ * make_runnable() can't fail.
+ */
+int
+scheduler_preallocate(int nthreads)
+{
+	assert(curspl>0);
+	return array_preallocate(runheap, nthreads);
+}
+
+/*
+ * This is called during panic shutdown to dispose of threads other
+ * than the one invoking panic. We drop them on the floor instead of
+ * cleaning them up properly; since we're about to go down it doesn't
+ * really matter, and freeing everything might cause further panics.
+ */
+void
+scheduler_killall(void)
+{
+	int i, result;
+
+	assert(curspl>0);
+	for (i=0; i<array_getnum(runheap); i++) {
+		struct thread *t = heap_get(i);
+		kprintf("scheduler: Dropping thread %s.\n", t->t_name);
+	}
+	result = array_setsize(runheap, 0);
+	/* Shrinking the array; not supposed to be able to fail. */
+	assert(result==0);
+}
+
+/*
+ * Cleanup function.
+ */
+void
+scheduler_shutdown(void)
+{
+	scheduler_killall();
+
+	assert(curspl>0);
+	array_destroy(runheap);
+	runheap = NULL;
+}
+
+/*
+ * Actual scheduler. Returns the next thread to run.  Calls cpu_idle()
+ * if there's nothing ready. (Note: cpu_idle must be called in a loop
+ * until something's ready - it doesn't know whether the things that
+ * wake it up are going to make a thread runnable or not.)
+ *
+ * Picks the runnable thread with the smallest pass.
+ */
+struct thread *
+scheduler(void)
+{
+	struct thread *t;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	while (array_getnum(runheap) == 0) {
+		cpu_idle();
+	}
+
+	t = heap_remmin();
+	global_pass = t->t_pass;
+	return t;
+}
+
+/*
+ * Make a thread runnable. A thread coming back from sleep (or brand
+ * new) is brought forward to the current virtual time, so it can't
+ * claim the CPU it didn't use while away.
+ */
+int
+make_runnable(struct thread *t)
+{
+	int result;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	if (STRIDE_PASS_LT(t->t_pass, global_pass)) {
+		t->t_pass = global_pass;
+	}
+
+	result = array_add(runheap, t);
+	if (result) {
+		return result;
+	}
+	heap_siftup(array_getnum(runheap)-1);
+	return 0;
+}
+
+/*
+ * Charge a clock tick to the current thread, and reschedule if some
+ * other thread is now further behind.
+ */
+int
+scheduler_tick(void)
+{
+	struct thread *t = curthread;
+
+	// called from hardclock, with interrupts off
+	assert(curspl>0);
+
+	/* In the idle loop; let thread_yield sort it out. */
+	if (t == NULL) {
+		return 1;
+	}
+
+	t->t_pass += t->t_stride;
+	t->t_runticks++;
+	total_ticks++;
+
+	return array_getnum(runheap) > 0 &&
+		STRIDE_PASS_LT(heap_get(0)->t_pass, t->t_pass);
+}
+
+/*
+ * Sleeping costs nothing under stride scheduling; make_runnable
+ * handles the catch-up when the thread comes back.
+ */
+void
+scheduler_block(struct thread *t)
+{
+	(void)t;
+}
+
+/*
+ * Give thread T a new number of tickets. Takes effect from its next
+ * tick. Returns EINVAL for zero or absurdly many tickets.
+ */
+int
+scheduler_settickets(struct thread *t, unsigned tickets)
+{
+	int spl;
+
+	if (tickets == 0 || tickets > STRIDE_MAXTICKETS) {
+		return EINVAL;
+	}
+
+	spl = splhigh();
+	t->t_tickets = tickets;
+	t->t_stride = STRIDE1 / tickets;
+	splx(spl);
+
+	return 0;
+}
+
+/*
+ * Report how many ticks thread T has run for, and how many ticks have
+ * been charged to all threads, so callers can work out the share T has
+ * actually received.
+ */
+void
+scheduler_getshare(struct thread *t, unsigned *ticks, unsigned *total)
+{
+	int spl = splhigh();
+
+	*ticks = t->t_runticks;
+	*total = total_ticks;
+	splx(spl);
+}
+
+/*
+ * Stride scheduling has no priorities to inherit.
+ */
+void
+scheduler_donate(struct thread *t, int pri)
+{
+	(void)t;
+	(void)pri;
+}
+
+int
+scheduler_priority(struct thread *t)
+{
+	(void)t;
+	return 0;
+}
+
+/*
+ * Debugging function to dump the run queue, in heap order.
+ */
+void
+print_run_queue(void)
+{
+	/* Turn interrupts off so the whole list prints atomically. */
+	int spl = splhigh();
+
+	int i;
+
+	for (i=0; i<array_getnum(runheap); i++) {
+		struct thread *t = heap_get(i);
+		kprintf("  %2d: %s %p pass %llu tickets %u\n", i, t->t_name,
+			t->t_sleepaddr, (unsigned long long)t->t_pass,
+			t->t_tickets);
+	}
+
+	splx(spl);
+}
+
+#else /* OPT_MLFQ */
+
+/*
+ *  Scheduler data
+ */
+
+// Queue of runnable threads
+static struct queue *runqueue;
+
+/*
+ * Setup function
+ */
+void
+scheduler_bootstrap(void)
+{
+	runqueue = q_create(32);
+	if (runqueue == NULL) {
+		panic("scheduler: Could not create run queue\n");
+	}
+}
+
+/*
+ * Ensure space for handling at least NTHREADS threads.
+ * This is done only to ensure that make_runnable() does not fail -
+ * if you change the scheduler to not require space outside the
+ * thread structure, for instance, this function can reasonably
+ * do nothing.
+ */
+int
+scheduler_preallocate(int nthreads)
+{
+	assert(curspl>0);
+	return q_preallocate(runqueue, nthreads);
+}
+
+/*
+ * This is called during panic shutdown to dispose of threads other
+ * than the one invoking panic. We drop them on the floor instead of
+ * cleaning them up properly; since we're about to go down it doesn't
+ * really matter, and freeing everything might cause further panics.
+ */
+void
+scheduler_killall(void)
+{
+	assert(curspl>0);
+	while (!q_empty(runqueue)) {
+		struct thread *t = q_remhead(runqueue);
+		kprintf("scheduler: Dropping thread %s.\n", t->t_name);
+	}
+}
+
+/*
+ * Cleanup function.
+ *
+ * The queue objects to being destroyed if it's got stuff in it.
+ * Use scheduler_killall to make sure this is the case. During
+ * ordinary shutdown, normally it should be.
+ */
+void
+scheduler_shutdown(void)
+{
+	scheduler_killall();
+
+	assert(curspl>0);
+	q_destroy(runqueue);
+	runqueue = NULL;
+}
+
+/*
+ * Actual scheduler. Returns the next thread to run.  Calls cpu_idle()
+ * if there's nothing ready. (Note: cpu_idle must be called in a loop
+ * until something's ready - it doesn't know whether the things that
+ * wake it up are going to make a thread runnable or not.)
+ */
+struct thread *
+scheduler(void)
+{
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	while (q_empty(runqueue)) {
+		cpu_idle();
+	}
+
+	// You can actually uncomment this to see what the scheduler's
+	// doing - even this deep inside thread code, the console
+	// still works. However, the amount of text printed is
+	// prohibitive.
+	//
+	//print_run_queue();
+
+	return q_remhead(runqueue);
+}
+
+/*
+ * Make a thread runnable.
+ * With the base scheduler, just add it to the end of the run queue.
+ */
+int
+make_runnable(struct thread *t)
+{
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	return q_addtail(runqueue, t);
+}
+
+/*
+ * Round robin: every tick is a reschedule.
+ */
+int
+scheduler_tick(void)
+{
+	return 1;
+}
+
+/*
+ * Round robin doesn't care why a thread sleeps.
+ */
+void
+scheduler_block(struct thread *t)
+{
+	(void)t;
+}
+
+/*
+ * Round robin has no priorities to inherit.
+ */
+void
+scheduler_donate(struct thread *t, int pri)
+{
+	(void)t;
+	(void)pri;
+}
+
+int
+scheduler_priority(struct thread *t)
+{
+	(void)t;
+	return 0;
+}
+
+/*
+ * Debugging function to dump the run queue.
+ */
+void
+print_run_queue(void)
+{
+	/* Turn interrupts off so the whole list prints atomically. */
+	int spl = splhigh();
+
+	int i,k=0;
+	i = q_getstart(runqueue);
+
+	while (i!=q_getend(runqueue)) {
+		struct thread *t = q_getguy(runqueue, i);
+		kprintf("  %2d: %s %p\n", k, t->t_name, t->t_sleepaddr);
+		i=(i+1)%q_getsize(runqueue);
+		k++;
+	}
+
+	splx(spl);
+}
+
+#endif /* OPT_MLFQ, OPT_STRIDE */
@@ -9,8 +9,23 @@
 #include <thread.h>
 #include <curthread.h>
 #include <machine/spl.h>
+#include <timeout.h>
 
 #include "opt-A1.h"
+#include "opt-mlfq.h"
+#include "opt-lockstat.h"
+
+#if OPT_LOCKSTAT
+#include <lockstat.h>
+#endif // OPT_LOCKSTAT
+
+#if OPT_A1
+#include <atomic.h>
+#endif // OPT_A1
+
+#if OPT_A1 && OPT_MLFQ
+#include <scheduler.h>
+#endif
 
 ////////////////////////////////////////////////////////////
 //
@@ -35,6 +50,9 @@ sem_create(const char *namearg, int initial_count)
 	}
 
 	sem->count = initial_count;
+#if OPT_LOCKSTAT
+	sem->stat = lockstat_get(namearg, LOCKSTAT_SEM);
+#endif // OPT_LOCKSTAT
 	return sem;
 }
 
@@ -61,10 +79,33 @@ sem_destroy(struct semaphore *sem)
 	kfree(sem);
 }
 
+#if OPT_A1
+/*
+ * Take a unit if there is one, with a compare-and-swap rather than by
+ * turning interrupts off. Returns nonzero if we got it.
+ */
+static
+int
+sem_trydown(struct semaphore *sem)
+{
+    int c;
+
+    while ((c = sem->count) > 0) {
+        if (atomic_cas_32((volatile u_int32_t *)&sem->count, c, c-1) == (u_int32_t)c) {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif // OPT_A1
+
 void 
 P(struct semaphore *sem)
 {
 	int spl;
+#if OPT_A1 && OPT_LOCKSTAT
+	u_int32_t start;
+#endif // OPT_A1 && OPT_LOCKSTAT
 	assert(sem != NULL);
 
 	/*
@@ -75,12 +116,42 @@ P(struct semaphore *sem)
 	 */
 	assert(in_interrupt==0);
 
+#if OPT_A1
+	// Uncontended: never touch spl
+	if (sem_trydown(sem)) {
+#if OPT_LOCKSTAT
+		lockstat_acquired(sem->stat, 0, 0);
+#endif // OPT_LOCKSTAT
+		return;
+	}
+#endif // OPT_A1
+
 	spl = splhigh();
+#if OPT_A1
+	if (sem_trydown(sem)) {
+#if OPT_LOCKSTAT
+		lockstat_acquired(sem->stat, 0, 0);
+#endif // OPT_LOCKSTAT
+	} else {
+#if OPT_LOCKSTAT
+		start = clock_ticks();
+#endif // OPT_LOCKSTAT
+		/*
+		 * V() gives its unit directly to the oldest sleeper instead
+		 * of bumping the count, so once woken we already own it.
+		 */
+		thread_sleep(sem);
+#if OPT_LOCKSTAT
+		lockstat_acquired(sem->stat, 1, clock_ticks() - start);
+#endif // OPT_LOCKSTAT
+	}
+#else
 	while (sem->count==0) {
 		thread_sleep(sem);
 	}
 	assert(sem->count>0);
 	sem->count--;
+#endif // OPT_A1
 	splx(spl);
 }
 
@@ -88,18 +159,197 @@ void
 V(struct semaphore *sem)
 {
 	int spl;
+#if OPT_A1
+	struct thread *woken;
+#endif // OPT_A1
 	assert(sem != NULL);
 	spl = splhigh();
+#if OPT_A1
+	// Hand the unit to a waiter if there is one, otherwise bank it
+	woken = thread_wakeup_one(sem);
+	if (woken == NULL) {
+		// P()'s fast path changes the count without spl
+		atomic_add_32((volatile u_int32_t *)&sem->count, 1);
+		assert(sem->count>0);
+	}
+#if OPT_LOCKSTAT
+	lockstat_released(sem->stat, woken != NULL, 0);
+#endif // OPT_LOCKSTAT
+#else
 	sem->count++;
 	assert(sem->count>0);
 	thread_wakeup(sem);
+#endif // OPT_A1
 	splx(spl);
 }
 
+#if OPT_A1
+int
+P_timeout(struct semaphore *sem, int nticks)
+{
+    int spl, result = 0;
+#if OPT_LOCKSTAT
+    u_int32_t start;
+    int contended;
+#endif // OPT_LOCKSTAT
+    assert(sem != NULL);
+
+    // Same rules as P()
+    assert(in_interrupt==0);
+
+    spl = splhigh();
+#if OPT_LOCKSTAT
+    start = clock_ticks();
+    contended = (sem->count == 0);
+#endif // OPT_LOCKSTAT
+    if (sem_trydown(sem)) {
+        // Never touches the timer wheel if we don't have to wait
+    } else if (thread_sleep_timeout(sem, nticks)) {
+        /*
+         * Timed out. The timeout took us off the sleep channel before any
+         * V() could pick us, so we were not handed a unit.
+         */
+        result = ETIMEDOUT;
+    }
+#if OPT_LOCKSTAT
+    if (result == 0) {
+        lockstat_acquired(sem->stat, contended, clock_ticks() - start);
+    }
+#endif // OPT_LOCKSTAT
+    splx(spl);
+
+    return result;
+}
+#endif // OPT_A1
+
 ////////////////////////////////////////////////////////////
 //
 // Lock.
 
+#if OPT_A1 && OPT_MLFQ
+/*
+ * Priority inheritance.
+ *
+ * A thread about to block on a lock lends its priority to the owner,
+ * and on to the owner of whatever lock that owner is blocked on, and so
+ * on down the chain. Each thread keeps a list of the locks it owns so
+ * that on release its donation can be recomputed from the waiters that
+ * are still left on the locks it holds.
+ */
+
+// Longest chain of owners we follow when donating (guards against cycles)
+#define PI_MAXDEPTH 16
+
+// Cleared by lock_setinherit() to turn inheritance off, for testing
+static int lock_inherit = 1;
+
+int
+lock_setinherit(int enable)
+{
+    int spl, was;
+
+    spl = splhigh();
+    was = lock_inherit;
+    lock_inherit = enable;
+    splx(spl);
+
+    return was;
+}
+
+static
+void
+lock_donate(struct lock *lock)
+{
+    int pri = scheduler_priority(curthread);
+    int depth;
+
+    assert(curspl>0);
+
+    if (!lock_inherit) {
+        return;
+    }
+
+    for (depth = 0; lock != NULL && depth < PI_MAXDEPTH; depth++) {
+        struct thread *owner = (struct thread *)lock->owner;
+
+        // Stop once the chain already runs at least this high
+        if (owner == NULL || scheduler_priority(owner) <= pri) {
+            break;
+        }
+        scheduler_donate(owner, pri);
+        lock = owner->t_blockedon;
+    }
+}
+
+/*
+ * Set T's donated priority to the best priority of the threads waiting
+ * on any lock it still holds.
+ */
+static
+void
+lock_redonate(struct thread *t)
+{
+    struct lock *l;
+    int best = PRI_NONE;
+
+    assert(curspl>0);
+
+    for (l = t->t_heldlocks; l != NULL && lock_inherit; l = l->next_held) {
+        int pri = thread_sleepers_toppri(l);
+        if (pri < best) {
+            best = pri;
+        }
+    }
+    scheduler_donate(t, best);
+}
+
+/*
+ * We've stopped waiting for LOCK without getting it. Take back what we
+ * lent down the chain of owners from there.
+ */
+static
+void
+lock_undonate(struct lock *lock)
+{
+    int depth;
+
+    assert(curspl>0);
+
+    for (depth = 0; lock != NULL && depth < PI_MAXDEPTH; depth++) {
+        struct thread *owner = (struct thread *)lock->owner;
+
+        if (owner == NULL) {
+            break;
+        }
+        lock_redonate(owner);
+        lock = owner->t_blockedon;
+    }
+}
+
+static
+void
+lock_addheld(struct thread *t, struct lock *lock)
+{
+    lock->next_held = t->t_heldlocks;
+    t->t_heldlocks = lock;
+}
+
+static
+void
+lock_delheld(struct thread *t, struct lock *lock)
+{
+    struct lock **pp = &t->t_heldlocks;
+
+    while (*pp != NULL && *pp != lock) {
+        pp = &(*pp)->next_held;
+    }
+    if (*pp != NULL) {
+        *pp = lock->next_held;
+    }
+    lock->next_held = NULL;
+}
+#endif // OPT_A1 && OPT_MLFQ
+
 struct lock *
 lock_create(const char *name)
 {
@@ -119,6 +369,15 @@ lock_create(const char *name)
 #if OPT_A1
 	lock->occupied = 0;
     lock->owner = NULL;
+    lock->handoffs = 0;
+    lock->wakeups_saved = 0;
+#if OPT_MLFQ
+    lock->next_held = NULL;
+#endif // OPT_MLFQ
+#if OPT_LOCKSTAT
+    lock->stat = lockstat_get(name, LOCKSTAT_LOCK);
+    lock->acquired_at = 0;
+#endif // OPT_LOCKSTAT
 #else
     // add stuff here as needed
 #endif // OPT_A1
@@ -152,6 +411,10 @@ lock_acquire(struct lock *lock)
 {
 #if OPT_A1
     int spl;
+#if OPT_LOCKSTAT
+    u_int32_t start;
+    int contended, reacquire;
+#endif // OPT_LOCKSTAT
 	assert(lock != NULL);
 
     // As with semaphores, don't block in an interrupt handler
@@ -159,17 +422,49 @@ lock_acquire(struct lock *lock)
 
     // Maintain same structure as semaphore; ensure this is atomic/not interrupted
     spl = splhigh();
+#if OPT_LOCKSTAT
+    start = clock_ticks();
+    contended = (lock->occupied && lock->owner != curthread);
+    reacquire = (lock->occupied && lock->owner == curthread);
+#endif // OPT_LOCKSTAT
+#if OPT_MLFQ
+    if (lock->occupied && lock->owner != curthread) {
+        // About to block; make sure the owner runs at least at our priority
+        curthread->t_blockedon = lock;
+        lock_donate(lock);
+    }
+#endif // OPT_MLFQ
 	while (lock->occupied && lock->owner != curthread) {
-        // Wait if the lock is being held by another thread (allow re-acquisition)
+        /*
+         * Wait if the lock is being held by another thread (allow re-acquisition).
+         * lock_release() makes us the owner before waking us, so this loop
+         * normally runs only once.
+         */
 		thread_sleep(lock);
 	}
 
     assert(!lock->occupied || (lock->occupied && lock->owner == curthread));
 
+#if OPT_MLFQ
+    curthread->t_blockedon = NULL;
+
+    // If we got it by handoff, lock_release() already did this
+    if (!lock->occupied) {
+        lock_addheld(curthread, lock);
+    }
+#endif // OPT_MLFQ
+
     // Set the occupied flag and make the current thread the owner
     lock->occupied = 1;
 	lock->owner = curthread;
 
+#if OPT_LOCKSTAT
+    if (!reacquire) {
+        lock->acquired_at = clock_ticks();
+        lockstat_acquired(lock->stat, contended, lock->acquired_at - start);
+    }
+#endif // OPT_LOCKSTAT
+
     // Restore previous priority level
 	splx(spl);
 #else
@@ -184,20 +479,77 @@ lock_release(struct lock *lock)
 {
 #if OPT_A1
 	int spl;
+    struct thread *next;
+#if OPT_MLFQ
+    struct thread *prev;
+#endif // OPT_MLFQ
     assert(lock != NULL);
 
     // Make this atomic
     spl = splhigh();
 
-    // Reset occupied flag and clear owner
-    lock->occupied = 0;
-    lock->owner = NULL;
+    /*
+     * Hand the lock straight to the longest waiting thread (under
+     * OPT_MLFQ, the most important one, so a waiter that was lending
+     * the owner its priority doesn't queue behind less important ones).
+     * Only that one thread is woken; waking them all would just send the
+     * rest back to sleep in lock_acquire().
+     */
+#if OPT_MLFQ
+    prev = (struct thread *)lock->owner;
+    if (prev != NULL) {
+        lock_delheld(prev, lock);
+    }
+#endif // OPT_MLFQ
+
+#if OPT_MLFQ
+    next = thread_wakeup_top(lock);
+#else
+    next = thread_wakeup_one(lock);
+#endif // OPT_MLFQ
+
+    if (next != NULL) {
+        // Still occupied, just by someone else now
+        lock->owner = next;
+        lock->handoffs++;
+        lock->wakeups_saved += thread_hassleepers(lock);
+#if OPT_MLFQ
+        // The new owner inherits from whoever is still waiting
+        lock_addheld(next, lock);
+        lock_redonate(next);
+#endif // OPT_MLFQ
+    } else {
+        // Reset occupied flag and clear owner
+        lock->occupied = 0;
+        lock->owner = NULL;
+    }
 
-    // Wake up a potential next owner
-	thread_wakeup(lock);
+#if OPT_LOCKSTAT
+    lockstat_released(lock->stat, next != NULL,
+                      clock_ticks() - lock->acquired_at);
+#endif // OPT_LOCKSTAT
+
+#if OPT_MLFQ
+    // Give back whatever was donated to us through this lock
+    if (prev != NULL) {
+        lock_redonate(prev);
+    }
+#endif // OPT_MLFQ
 
     // Restore previous priority level
 	splx(spl);
+
+#if OPT_MLFQ
+    /*
+     * If we just handed off to a more important thread, let it run now
+     * rather than at the next tick. Not if the caller had interrupts off,
+     * though (cv_wait relies on not being switched out here).
+     */
+    if (spl == 0 && next != NULL &&
+        scheduler_priority(next) < scheduler_priority(curthread)) {
+        thread_yield();
+    }
+#endif // OPT_MLFQ
 #else
     // Write this
 
@@ -230,11 +582,83 @@ lock_tryacquire(struct lock *lock)
 
     return 1;
 }
+
+int
+lock_acquire_timeout(struct lock *lock, int nticks)
+{
+    int spl;
+    u_int32_t deadline;
+#if OPT_LOCKSTAT
+    u_int32_t start;
+    int contended, reacquire;
+#endif // OPT_LOCKSTAT
+    assert(lock != NULL);
+
+    // Same rules as lock_acquire()
+    assert(in_interrupt==0);
+
+    spl = splhigh();
+    deadline = clock_ticks() + nticks;
+#if OPT_LOCKSTAT
+    start = clock_ticks();
+    contended = (lock->occupied && lock->owner != curthread);
+    reacquire = (lock->occupied && lock->owner == curthread);
+#endif // OPT_LOCKSTAT
+
+#if OPT_MLFQ
+    if (lock->occupied && lock->owner != curthread) {
+        curthread->t_blockedon = lock;
+        lock_donate(lock);
+    }
+#endif // OPT_MLFQ
+
+    // If the lock is free this falls straight through, never arming a timeout
+    while (lock->occupied && lock->owner != curthread) {
+        int left = (int)(deadline - clock_ticks());
+
+        if (left <= 0 || thread_sleep_timeout(lock, left)) {
+            // Gave up; we're no longer on the lock's sleep channel
+#if OPT_MLFQ
+            curthread->t_blockedon = NULL;
+            lock_undonate(lock);
+#endif // OPT_MLFQ
+            splx(spl);
+            return ETIMEDOUT;
+        }
+    }
+
+#if OPT_MLFQ
+    curthread->t_blockedon = NULL;
+
+    // If we got it by handoff, lock_release() already did this
+    if (!lock->occupied) {
+        lock_addheld(curthread, lock);
+    }
+#endif // OPT_MLFQ
+
+    lock->occupied = 1;
+    lock->owner = curthread;
+
+#if OPT_LOCKSTAT
+    if (!reacquire) {
+        lock->acquired_at = clock_ticks();
+        lockstat_acquired(lock->stat, contended, lock->acquired_at - start);
+    }
+#endif // OPT_LOCKSTAT
+
+    splx(spl);
+    return 0;
+}
 #endif // OPT_A1
 
 ////////////////////////////////////////////////////////////
 //
 // CV
+//
+// Under OPT_A1 a waiter sleeps on the CV's own address. The wait channel
+// strings its sleepers together through links embedded in struct thread,
+// in FIFO order, so waiting never allocates and signalling wakes the
+// longest waiter without any separate queue.
 
 
 struct cv *
@@ -254,11 +678,10 @@ cv_create(const char *name)
 	}
 
 #if OPT_A1
-    // Initialize counter
-    cv->count = 0;
-
-    // Create queue
-    cv->q = q_create(1);
+    // Nothing else to set up; waiters queue on the wait channel
+#if OPT_LOCKSTAT
+    cv->stat = lockstat_get(name, LOCKSTAT_CV);
+#endif // OPT_LOCKSTAT
 #else
 	// add stuff here as needed
 #endif // OPT_A1
@@ -269,17 +692,16 @@ cv_create(const char *name)
 void
 cv_destroy(struct cv *cv)
 {
+#if OPT_A1
+    int spl;
+#endif // OPT_A1
 	assert(cv != NULL);
 
 #if OPT_A1
     // Ensure that we have no one waiting
-    assert(cv->count == 0);
-
-    // Ensure the queue is empty
-    assert(q_empty(cv->q));
-
-    // Destory the queue
-    q_destroy(cv->q);
+    spl = splhigh();
+    assert(thread_hassleepers(cv) == 0);
+    splx(spl);
 #else
 	// add stuff here as needed
 #endif // OPT_A1
@@ -298,6 +720,9 @@ cv_wait(struct cv *cv, struct lock *lock)
 {
 #if OPT_A1
     int spl;
+#if OPT_LOCKSTAT
+    u_int32_t start;
+#endif // OPT_LOCKSTAT
 
     // Ensure that both locks exist, and that we currently own the mutex lock
     assert(cv != NULL);
@@ -313,21 +738,19 @@ cv_wait(struct cv *cv, struct lock *lock)
     // Release the mutex lock
     lock_release(lock);
 
-    // Increment waiting count
-    cv->count++;
-
-    // Expand the queue, if necessary
-    assert(!q_preallocate(cv->q, cv->count));
-
-    // Add this thread to the queue
-    assert(!q_addtail(cv->q, curthread));
+#if OPT_LOCKSTAT
+    start = clock_ticks();
+#endif // OPT_LOCKSTAT
 
     /*
-     * Put this thread to sleep. Have its addr key as a pointer to itself for 2 reasons:
-     * 1) Ensure FIFO ordering for signalled threads.
-     * 2) Ensure 1 thread is woken up at a time.
+     * Sleep on the cv itself. The wait channel keeps its sleepers in FIFO
+     * order, so signalled threads are woken oldest first, one at a time.
      */
-    thread_sleep(curthread);
+    thread_sleep(cv);
+
+#if OPT_LOCKSTAT
+    lockstat_acquired(cv->stat, 1, clock_ticks() - start);
+#endif // OPT_LOCKSTAT
 
     // Once woken up, reacquire the same mutex lock (may sleep again)
     lock_acquire(lock);
@@ -341,6 +764,48 @@ cv_wait(struct cv *cv, struct lock *lock)
 #endif // OPT_A1
 }
 
+#if OPT_A1
+int
+cv_timedwait(struct cv *cv, struct lock *lock, int nticks)
+{
+    int spl, result = 0;
+#if OPT_LOCKSTAT
+    u_int32_t start;
+#endif // OPT_LOCKSTAT
+
+    assert(cv != NULL);
+    assert(lock != NULL);
+    assert(lock_do_i_hold(lock));
+	assert(in_interrupt==0);
+
+    // Same as cv_wait() up to going to sleep
+    spl = splhigh();
+    lock_release(lock);
+
+#if OPT_LOCKSTAT
+    start = clock_ticks();
+#endif // OPT_LOCKSTAT
+
+    /*
+     * If the timeout fires first it takes us off the cv's wait channel, so
+     * no cv_signal() can be spent on us after that.
+     */
+    if (thread_sleep_timeout(cv, nticks)) {
+        result = ETIMEDOUT;
+    }
+#if OPT_LOCKSTAT
+    else {
+        lockstat_acquired(cv->stat, 1, clock_ticks() - start);
+    }
+#endif // OPT_LOCKSTAT
+
+    lock_acquire(lock);
+	splx(spl);
+
+    return result;
+}
+#endif // OPT_A1
+
 void
 cv_signal(struct cv *cv, struct lock *lock)
 {
@@ -359,14 +824,12 @@ cv_signal(struct cv *cv, struct lock *lock)
     // Begin atomicity
     spl = splhigh();
 
-    // Decrement waiting thread count
-    cv->count--;
-
-    // Dequeue next waiting thread
-    struct thread *signalled = q_remhead(cv->q);
-    
-    // Wake up a thread
-    thread_wakeup(signalled);
+    // Wake up the longest waiting thread, if any
+#if OPT_LOCKSTAT
+    lockstat_released(cv->stat, thread_wakeup_one(cv) != NULL, 0);
+#else
+    thread_wakeup_one(cv);
+#endif // OPT_LOCKSTAT
 
     // Restore previous priority level
 	splx(spl);
@@ -381,20 +844,468 @@ void
 cv_broadcast(struct cv *cv, struct lock *lock)
 {
 #if OPT_A1
+    int spl;
+
     assert(cv != NULL);
     assert(lock != NULL);
     assert(lock_do_i_hold(lock));
 
-    // Just call signal() until all the threads are woken up
-    while (cv->count > 0) {
-        cv_signal(cv, lock);
-    }
-
-    assert(cv->count == 0);
-    assert(q_empty(cv->q));
+    // Move every waiter to the run queue in one pass over the channel
+    spl = splhigh();
+#if OPT_LOCKSTAT
+    lockstat_released(cv->stat, thread_hassleepers(cv), 0);
+#endif // OPT_LOCKSTAT
+    thread_wakeup(cv);
+    assert(thread_hassleepers(cv) == 0);
+	splx(spl);
 #else
 	// Write this
 	(void)cv;    // suppress warning until code gets written
 	(void)lock;  // suppress warning until code gets written
 #endif // OPT_A1
 }
+
+#if OPT_A1
+////////////////////////////////////////////////////////////
+//
+// Reader-writer lock.
+
+struct rwlock *
+rwlock_create(const char *name, int prefer_writer)
+{
+    struct rwlock *rw;
+
+    rw = kmalloc(sizeof(struct rwlock));
+    if (rw == NULL) {
+        return NULL;
+    }
+
+    rw->name = kstrdup(name);
+    if (rw->name == NULL) {
+        kfree(rw);
+        return NULL;
+    }
+
+    rw->prefer_writer = prefer_writer;
+    rw->readers = 0;
+    rw->rwaiting = 0;
+    rw->wwaiting = 0;
+    rw->writer = NULL;
+
+    return rw;
+}
+
+void
+rwlock_destroy(struct rwlock *rw)
+{
+    assert(rw != NULL);
+
+    // Ensure no one holds or waits for the lock
+    assert(rw->readers == 0 && rw->writer == NULL);
+    assert(rw->rwaiting == 0 && rw->wwaiting == 0);
+
+    kfree(rw->name);
+    kfree(rw);
+}
+
+/*
+ * The lock has just become free. Hand it to the next writer, or to every
+ * waiting reader at once, according to the lock's preference.
+ */
+static
+void
+rw_grant(struct rwlock *rw)
+{
+    assert(curspl>0);
+    assert(rw->readers == 0 && rw->writer == NULL);
+
+    if (rw->wwaiting > 0 && (rw->prefer_writer || rw->rwaiting == 0)) {
+        rw->writer = thread_wakeup_one(&rw->writer);
+        assert(rw->writer != NULL);
+        rw->wwaiting--;
+    } else if (rw->rwaiting > 0) {
+        // The whole batch of readers goes in together
+        rw->readers = rw->rwaiting;
+        rw->rwaiting = 0;
+        thread_wakeup(rw);
+    }
+}
+
+void
+rw_rlock(struct rwlock *rw)
+{
+    int spl;
+    assert(rw != NULL);
+    assert(in_interrupt==0);
+
+    spl = splhigh();
+    assert(rw->writer != curthread);
+
+    if (rw->writer == NULL && !(rw->prefer_writer && rw->wwaiting > 0)) {
+        rw->readers++;
+    } else {
+        // rw_grant() counts us in among the readers before waking us
+        rw->rwaiting++;
+        thread_sleep(rw);
+    }
+    assert(rw->readers > 0 && rw->writer == NULL);
+
+    splx(spl);
+}
+
+void
+rw_wlock(struct rwlock *rw)
+{
+    int spl;
+    assert(rw != NULL);
+    assert(in_interrupt==0);
+
+    spl = splhigh();
+    assert(rw->writer != curthread);
+
+    if (rw->writer == NULL && rw->readers == 0) {
+        rw->writer = curthread;
+    } else {
+        // rw_grant() makes us the writer before waking us
+        rw->wwaiting++;
+        thread_sleep(&rw->writer);
+    }
+    assert(rw->writer == curthread && rw->readers == 0);
+
+    splx(spl);
+}
+
+void
+rw_unlock(struct rwlock *rw)
+{
+    int spl;
+    assert(rw != NULL);
+
+    spl = splhigh();
+
+    if (rw->writer == curthread) {
+        rw->writer = NULL;
+        rw_grant(rw);
+    } else {
+        // Must be one of the readers, then
+        assert(rw->readers > 0);
+        rw->readers--;
+        if (rw->readers == 0) {
+            rw_grant(rw);
+        }
+    }
+
+    splx(spl);
+}
+#endif // OPT_A1
+
+#if OPT_A1
+////////////////////////////////////////////////////////////
+//
+// Adaptive mutex.
+//
+// The owner word is only ever changed by compare-and-swap, except by
+// mutex_unlock() handing the mutex to a sleeper, which it does with
+// interrupts off. Setting MUTEX_WAITERS makes the unlock fast path's
+// compare-and-swap fail, so the unlocker always notices it has somebody
+// to wake.
+//
+// A contended mutex_lock() first spins, for at most MUTEX_SPIN rounds,
+// as long as the owner is running on another processor (thread_oncpu()):
+// such an owner may well let go before we could have gone to sleep and
+// been woken. Once the owner isn't running, or the rounds run out, we
+// sleep. This kernel runs on one processor (MUTEX_NCPUS), where the owner
+// can never be running while we are, so the spin phase is compiled out.
+//
+// Going to sleep is interlocked against the wakeup with splhigh(), as
+// thread_sleep() and everything else in this kernel is. That is only
+// enough on one processor; running on more would need a spinlock around
+// the sleep channel here and in thread.c.
+
+// Processors the kernel runs on; the spin phase needs more than one
+#define MUTEX_NCPUS     1
+
+// Most rounds a contended mutex_lock() spins before sleeping
+#define MUTEX_SPIN      1000
+
+struct mutex *
+mutex_create(const char *name)
+{
+    struct mutex *m;
+
+    m = kmalloc(sizeof(struct mutex));
+    if (m == NULL) {
+        return NULL;
+    }
+
+    m->name = kstrdup(name);
+    if (m->name == NULL) {
+        kfree(m);
+        return NULL;
+    }
+
+    m->owner = 0;
+
+    return m;
+}
+
+void
+mutex_destroy(struct mutex *m)
+{
+    assert(m != NULL);
+
+    // Ensure no one holds the mutex
+    assert(m->owner == 0);
+
+    kfree(m->name);
+    kfree(m);
+}
+
+/*
+ * Contended case of mutex_lock().
+ */
+static
+void
+mutex_lock_slow(struct mutex *m)
+{
+    u_int32_t me = (u_int32_t)curthread;
+    u_int32_t o;
+    int spl;
+#if MUTEX_NCPUS > 1
+    int spins;
+
+    // Spin while the owner is running elsewhere
+    for (spins = 0; spins < MUTEX_SPIN; spins++) {
+        o = m->owner;
+        if (o == 0) {
+            if (atomic_cas_32(&m->owner, 0, me) == 0) {
+                return;
+            }
+        }
+        else if (!thread_oncpu(MUTEX_OWNER(o))) {
+            break;
+        }
+    }
+#endif // MUTEX_NCPUS > 1
+
+    spl = splhigh();
+    for (;;) {
+        o = m->owner;
+        if (o == 0) {
+            if (atomic_cas_32(&m->owner, 0, me) == 0) {
+                break;
+            }
+            continue;
+        }
+
+        // Flag that there's a sleeper, so the owner can't unlock past us
+        if (atomic_cas_32(&m->owner, o, o | MUTEX_WAITERS) != o) {
+            continue;
+        }
+        thread_sleep(m);
+
+        // mutex_unlock() made us the owner before waking us
+        assert(MUTEX_OWNER(m->owner) == curthread);
+        break;
+    }
+    splx(spl);
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+    assert(m != NULL);
+
+    // As with locks, don't block in an interrupt handler
+    assert(in_interrupt==0);
+    assert(MUTEX_OWNER(m->owner) != curthread);
+
+    // Uncontended: one compare-and-swap, no spl
+    if (atomic_cas_32(&m->owner, 0, (u_int32_t)curthread) == 0) {
+        return;
+    }
+    mutex_lock_slow(m);
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+    u_int32_t me = (u_int32_t)curthread;
+    struct thread *next;
+    int spl;
+
+    assert(m != NULL);
+    assert(MUTEX_OWNER(m->owner) == curthread);
+
+    // Nobody asleep on it: one compare-and-swap, no spl
+    if (atomic_cas_32(&m->owner, me, 0) == me) {
+        return;
+    }
+
+    // Hand it straight to the oldest sleeper
+    spl = splhigh();
+    next = thread_wakeup_one(m);
+    if (next == NULL) {
+        m->owner = 0;
+    } else {
+        m->owner = (u_int32_t)next |
+            (thread_hassleepers(m) ? MUTEX_WAITERS : 0);
+    }
+    splx(spl);
+}
+
+int
+mutex_do_i_hold(struct mutex *m)
+{
+    return MUTEX_OWNER(m->owner) == curthread;
+}
+#endif // OPT_A1
+
+#if OPT_A1
+////////////////////////////////////////////////////////////
+//
+// Barrier.
+
+struct barrier *
+barrier_create(const char *name, int nthreads)
+{
+    struct barrier *b;
+
+    assert(nthreads > 0);
+
+    b = kmalloc(sizeof(struct barrier));
+    if (b == NULL) {
+        return NULL;
+    }
+
+    b->name = kstrdup(name);
+    if (b->name == NULL) {
+        kfree(b);
+        return NULL;
+    }
+
+    b->nthreads = nthreads;
+    b->arrived = 0;
+    b->generation = 0;
+
+    return b;
+}
+
+void
+barrier_destroy(struct barrier *b)
+{
+    assert(b != NULL);
+
+    // Ensure no one is still waiting at it
+    assert(b->arrived == 0);
+
+    kfree(b->name);
+    kfree(b);
+}
+
+int
+barrier_wait(struct barrier *b)
+{
+    int spl, last = 0;
+    unsigned gen;
+
+    assert(b != NULL);
+    assert(in_interrupt==0);
+
+    spl = splhigh();
+
+    gen = b->generation;
+    b->arrived++;
+    assert(b->arrived <= b->nthreads);
+
+    if (b->arrived == b->nthreads) {
+        // Last one in opens it for everybody, with a single wakeup
+        b->arrived = 0;
+        b->generation++;
+        thread_wakeup(b);
+        last = 1;
+    } else {
+        while (b->generation == gen) {
+            thread_sleep(b);
+        }
+    }
+
+    splx(spl);
+
+    return last;
+}
+
+////////////////////////////////////////////////////////////
+//
+// Countdown latch.
+
+struct latch *
+latch_create(const char *name, int count)
+{
+    struct latch *l;
+
+    assert(count >= 0);
+
+    l = kmalloc(sizeof(struct latch));
+    if (l == NULL) {
+        return NULL;
+    }
+
+    l->name = kstrdup(name);
+    if (l->name == NULL) {
+        kfree(l);
+        return NULL;
+    }
+
+    l->count = count;
+
+    return l;
+}
+
+void
+latch_destroy(struct latch *l)
+{
+    int spl;
+    assert(l != NULL);
+
+    // Ensure no one is still waiting on it
+    spl = splhigh();
+    assert(thread_hassleepers(l) == 0);
+    splx(spl);
+
+    kfree(l->name);
+    kfree(l);
+}
+
+void
+latch_countdown(struct latch *l)
+{
+    int spl;
+    assert(l != NULL);
+
+    spl = splhigh();
+
+    assert(l->count > 0);
+    l->count--;
+    if (l->count == 0) {
+        // Release all the waiters with a single wakeup
+        thread_wakeup(l);
+    }
+
+    splx(spl);
+}
+
+void
+latch_wait(struct latch *l)
+{
+    int spl;
+    assert(l != NULL);
+    assert(in_interrupt==0);
+
+    spl = splhigh();
+    while (l->count > 0) {
+        thread_sleep(l);
+    }
+    splx(spl);
+}
+#endif // OPT_A1
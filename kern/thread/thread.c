@@ -12,7 +12,16 @@
 #include <scheduler.h>
 #include <addrspace.h>
 #include <vnode.h>
+#include <atomic.h>
 #include "opt-synchprobs.h"
+#include "opt-A1.h"
+#include "opt-A2.h"
+#include "opt-mlfq.h"
+#include "opt-stride.h"
+
+#if OPT_A2
+#include <proc.h>
+#endif // OPT_A2
 
 /* States a thread can be in. */
 typedef enum {
@@ -25,14 +34,231 @@ typedef enum {
 /* Global variable for the thread currently executing at any given time. */
 struct thread *curthread;
 
+#if OPT_A1
+/*
+ * Wait channel: the FIFO of threads sleeping on one sleep address.
+ *
+ * Every thread owns exactly one wchan while it is not asleep. The first
+ * thread to sleep on an address lends its wchan to the hash table as the
+ * channel; later sleepers park their own on the channel's spare list. A
+ * thread leaving the channel takes a spare back, or the channel itself if
+ * it was the last one out. So sleeping and waking never allocate.
+ */
+struct wchan {
+	const void *wc_addr;		/* sleep address (hash key) */
+	struct thread *wc_head;		/* oldest sleeper */
+	struct thread *wc_tail;		/* newest sleeper */
+	int wc_count;			/* number of sleepers */
+	struct wchan *wc_next;		/* hash chain */
+	struct wchan *wc_spare;		/* wchans donated by the sleepers */
+};
+
+/* Number of sleep hash buckets. Must be a power of 2. */
+#define SLEEPQ_SIZE  128
+
+/* Hash table of active wait channels, keyed by sleep address. */
+static struct wchan **sleepq;
+
+#define SLEEPQ_HASH(addr) \
+	((((u_int32_t)(addr) >> 4) ^ ((u_int32_t)(addr) >> 12)) & (SLEEPQ_SIZE-1))
+#else
 /* Table of sleeping threads. */
 static struct array *sleepers;
+#endif // OPT_A1
 
 /* List of dead threads to be disposed of. */
 static struct array *zombies;
 
 /* Total number of outstanding threads. Does not count zombies[]. */
+#if OPT_A1
+/* Only changed with atomic_add_32, so it can be read without spl. */
+static volatile u_int32_t numthreads;
+#else
 static int numthreads;
+#endif // OPT_A1
+
+#if OPT_A1
+/*
+ * Cache of dead threads, kept together with their kernel stacks and
+ * wchans so that thread_fork() can recycle them instead of going back
+ * to kmalloc. When the cache grows past the high watermark it is
+ * trimmed back down to the low watermark.
+ */
+static struct thread *thread_cache;
+static int thread_cache_count;
+static int thread_cache_lowat = THREAD_CACHE_LOWAT;
+static int thread_cache_hiwat = THREAD_CACHE_HIWAT;
+static unsigned thread_cache_hits;
+static unsigned thread_cache_misses;
+static unsigned thread_cache_frees;
+
+/*
+ * Really free a thread structure and everything hanging off it.
+ */
+static
+void
+thread_free(struct thread *thread)
+{
+	if (thread->t_stack) {
+		kfree(thread->t_stack);
+	}
+	kfree(thread->t_wchan);
+	kfree(thread);
+}
+
+/*
+ * Pull a thread from the cache, or allocate a fresh one (with no stack)
+ * if the cache is empty.
+ */
+static
+struct thread *
+thread_cache_get(void)
+{
+	struct thread *thread;
+	int s;
+
+	s = splhigh();
+	thread = thread_cache;
+	if (thread != NULL) {
+		/* Cached threads are linked through t_wqnext. */
+		thread_cache = thread->t_wqnext;
+		thread_cache_count--;
+		thread_cache_hits++;
+	}
+	else {
+		thread_cache_misses++;
+	}
+	splx(s);
+
+	if (thread != NULL) {
+		return thread;
+	}
+
+	thread = kmalloc(sizeof(struct thread));
+	if (thread==NULL) {
+		return NULL;
+	}
+	thread->t_wchan = kmalloc(sizeof(struct wchan));
+	if (thread->t_wchan==NULL) {
+		kfree(thread);
+		return NULL;
+	}
+	thread->t_stack = NULL;
+	return thread;
+}
+
+/*
+ * Return a dead thread to the cache. Threads without a stack (that is,
+ * the boot thread) aren't worth keeping.
+ */
+static
+void
+thread_cache_put(struct thread *thread)
+{
+	struct thread *trim = NULL;
+	int s;
+
+	s = splhigh();
+	if (thread->t_stack != NULL && thread_cache_hiwat > 0) {
+		thread->t_wqnext = thread_cache;
+		thread_cache = thread;
+		thread_cache_count++;
+		thread = NULL;
+
+		/* Over the high watermark: cut back to the low one. */
+		if (thread_cache_count > thread_cache_hiwat) {
+			while (thread_cache_count > thread_cache_lowat) {
+				struct thread *t = thread_cache;
+				thread_cache = t->t_wqnext;
+				thread_cache_count--;
+				t->t_wqnext = trim;
+				trim = t;
+			}
+		}
+	}
+	splx(s);
+
+	if (thread != NULL) {
+		thread_cache_frees++;
+		thread_free(thread);
+	}
+	while (trim != NULL) {
+		struct thread *t = trim;
+		trim = t->t_wqnext;
+		thread_cache_frees++;
+		thread_free(t);
+	}
+}
+
+/*
+ * Set the thread cache watermarks. Returns EINVAL if LOWAT > HIWAT.
+ */
+int
+thread_cache_setwat(int lowat, int hiwat)
+{
+	struct thread *trim = NULL;
+	int s;
+
+	if (lowat < 0 || lowat > hiwat) {
+		return EINVAL;
+	}
+
+	s = splhigh();
+	thread_cache_lowat = lowat;
+	thread_cache_hiwat = hiwat;
+	while (thread_cache_count > thread_cache_hiwat) {
+		struct thread *t = thread_cache;
+		thread_cache = t->t_wqnext;
+		thread_cache_count--;
+		t->t_wqnext = trim;
+		trim = t;
+	}
+	splx(s);
+
+	while (trim != NULL) {
+		struct thread *t = trim;
+		trim = t->t_wqnext;
+		thread_cache_frees++;
+		thread_free(t);
+	}
+	return 0;
+}
+
+/*
+ * Print thread cache statistics.
+ */
+void
+thread_cache_stats(void)
+{
+	kprintf("thread cache: %d cached (low %d, high %d), "
+		"%u hits, %u misses, %u freed\n",
+		thread_cache_count, thread_cache_lowat, thread_cache_hiwat,
+		thread_cache_hits, thread_cache_misses, thread_cache_frees);
+}
+
+/*
+ * Menu command. "threadcache" prints the statistics; "threadcache LOWAT
+ * HIWAT" sets the watermarks first.
+ */
+int
+cmd_threadcache(int nargs, char **args)
+{
+	if (nargs == 3) {
+		if (thread_cache_setwat(atoi(args[1]), atoi(args[2]))) {
+			kprintf("threadcache: need 0 <= LOWAT <= HIWAT\n");
+			return EINVAL;
+		}
+	}
+	else if (nargs != 1) {
+		kprintf("Usage: threadcache [LOWAT HIWAT]\n");
+		return EINVAL;
+	}
+	thread_cache_stats();
+	return 0;
+}
+
+static void thread_timeout_expire(void *data);
+#endif // OPT_A1
 
 /*
  * Create a thread. This is used both to create the first thread's 
@@ -43,6 +269,32 @@ static
 struct thread *
 thread_create(const char *name)
 {
+#if OPT_A1
+	/* May come from the cache, in which case it already has a stack. */
+	struct thread *thread = thread_cache_get();
+	if (thread==NULL) {
+		return NULL;
+	}
+	if (strlen(name) < sizeof(thread->t_namebuf)) {
+		strcpy(thread->t_namebuf, name);
+		thread->t_name = thread->t_namebuf;
+	}
+	else {
+		thread->t_name = kstrdup(name);
+		if (thread->t_name==NULL) {
+			thread_cache_put(thread);
+			return NULL;
+		}
+	}
+	thread->t_sleepaddr = NULL;
+	thread->t_sleepchan = NULL;
+	thread->t_wqnext = thread->t_wqprev = NULL;
+	thread->t_joinable = 0;
+	thread->t_exited = 0;
+	thread->t_exitval = 0;
+	thread->t_timedout = 0;
+	timeout_set(&thread->t_timeout, thread_timeout_expire, thread);
+#else
 	struct thread *thread = kmalloc(sizeof(struct thread));
 	if (thread==NULL) {
 		return NULL;
@@ -54,10 +306,33 @@ thread_create(const char *name)
 	}
 	thread->t_sleepaddr = NULL;
 	thread->t_stack = NULL;
+#endif // OPT_A1
 	
 	thread->t_vmspace = NULL;
 
 	thread->t_cwd = NULL;
+#if OPT_A2
+	thread->t_proc = NULL;
+#endif // OPT_A2
+
+#if OPT_MLFQ
+	/* New threads start out at the top level. */
+	thread->t_priority = 0;
+	thread->t_ticks = 0;
+	thread->t_epoch = 0;
+	thread->t_rqnext = thread->t_rqprev = NULL;
+	thread->t_rqpri = -1;
+	thread->t_donated = PRI_NONE;
+	thread->t_blockedon = NULL;
+	thread->t_heldlocks = NULL;
+#endif // OPT_MLFQ
+#if OPT_STRIDE
+	/* make_runnable brings t_pass up to the current virtual time. */
+	thread->t_tickets = STRIDE_DEFTICKETS;
+	thread->t_stride = STRIDE1 / STRIDE_DEFTICKETS;
+	thread->t_pass = 0;
+	thread->t_runticks = 0;
+#endif // OPT_STRIDE
 	
 	// If you add things to the thread structure, be sure to initialize
 	// them here.
@@ -83,15 +358,173 @@ thread_destroy(struct thread *thread)
 	// These things are cleaned up in thread_exit.
 	assert(thread->t_vmspace==NULL);
 	assert(thread->t_cwd==NULL);
-	
+
+#if OPT_A1
+	/* A thread that is not asleep always holds exactly one wchan. */
+	assert(thread->t_sleepchan==NULL);
+	assert(thread->t_wchan!=NULL);
+
+	if (thread->t_name != thread->t_namebuf) {
+		kfree(thread->t_name);
+	}
+	thread->t_name = NULL;
+
+	/* Keep the structure, stack and wchan around for the next fork. */
+	thread_cache_put(thread);
+#else
 	if (thread->t_stack) {
 		kfree(thread->t_stack);
 	}
 
 	kfree(thread->t_name);
 	kfree(thread);
+#endif // OPT_A1
 }
 
+#if OPT_A1
+/*
+ * Find the wait channel for sleep address ADDR, or NULL if nobody is
+ * sleeping on it. Expected O(1): each bucket only chains the distinct
+ * addresses that currently have sleepers.
+ */
+static
+struct wchan *
+wchan_lookup(const void *addr)
+{
+	struct wchan *wc;
+
+	for (wc = sleepq[SLEEPQ_HASH(addr)]; wc != NULL; wc = wc->wc_next) {
+		if (wc->wc_addr == addr) {
+			return wc;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Put the current thread at the tail of the wait channel for ADDR,
+ * creating the channel out of the thread's own wchan if necessary.
+ */
+static
+void
+wchan_enqueue(struct thread *t, const void *addr)
+{
+	struct wchan *wc = wchan_lookup(addr);
+
+	assert(t->t_wchan != NULL);
+
+	if (wc == NULL) {
+		/* First sleeper: lend our wchan to the table as the channel. */
+		u_int32_t b = SLEEPQ_HASH(addr);
+
+		wc = t->t_wchan;
+		wc->wc_addr = addr;
+		wc->wc_head = wc->wc_tail = NULL;
+		wc->wc_count = 0;
+		wc->wc_spare = NULL;
+		wc->wc_next = sleepq[b];
+		sleepq[b] = wc;
+	}
+	else {
+		/* Channel exists; park our wchan on its spare list. */
+		t->t_wchan->wc_spare = wc->wc_spare;
+		wc->wc_spare = t->t_wchan;
+	}
+	t->t_wchan = NULL;
+
+	t->t_sleepchan = wc;
+	t->t_wqnext = NULL;
+	t->t_wqprev = wc->wc_tail;
+	if (wc->wc_tail != NULL) {
+		wc->wc_tail->t_wqnext = t;
+	}
+	else {
+		wc->wc_head = t;
+	}
+	wc->wc_tail = t;
+	wc->wc_count++;
+}
+
+/*
+ * Take thread T off the wait channel it is sleeping on, and hand it back
+ * a wchan to own. Does not make T runnable.
+ */
+static
+void
+wchan_dequeue(struct thread *t)
+{
+	struct wchan *wc = t->t_sleepchan;
+
+	assert(wc != NULL);
+	assert(t->t_wchan == NULL);
+
+	if (t->t_wqprev != NULL) {
+		t->t_wqprev->t_wqnext = t->t_wqnext;
+	}
+	else {
+		wc->wc_head = t->t_wqnext;
+	}
+	if (t->t_wqnext != NULL) {
+		t->t_wqnext->t_wqprev = t->t_wqprev;
+	}
+	else {
+		wc->wc_tail = t->t_wqprev;
+	}
+	t->t_wqnext = t->t_wqprev = NULL;
+	t->t_sleepchan = NULL;
+	wc->wc_count--;
+
+	if (wc->wc_count > 0) {
+		/* Others still waiting; take one of the spares. */
+		t->t_wchan = wc->wc_spare;
+		wc->wc_spare = t->t_wchan->wc_spare;
+	}
+	else {
+		/* Last one out takes the channel itself out of the table. */
+		struct wchan **pp = &sleepq[SLEEPQ_HASH(wc->wc_addr)];
+
+		while (*pp != wc) {
+			pp = &(*pp)->wc_next;
+		}
+		*pp = wc->wc_next;
+
+		assert(wc->wc_spare == NULL);
+		wc->wc_addr = NULL;
+		t->t_wchan = wc;
+	}
+	assert(t->t_wchan != NULL);
+}
+
+/*
+ * Expiry function for a thread's own timeout. Runs from the clock
+ * interrupt. If the thread is still asleep, on whatever address, it is
+ * pulled off that wait channel and made runnable with t_timedout set.
+ * If it has already been woken, there is nothing to do.
+ */
+static
+void
+thread_timeout_expire(void *data)
+{
+	struct thread *t = data;
+	int result;
+
+	assert(curspl>0);
+
+	if (t->t_sleepchan == NULL) {
+		return;
+	}
+	wchan_dequeue(t);
+	t->t_timedout = 1;
+
+	/*
+	 * Because we preallocate during thread_fork,
+	 * this should never fail.
+	 */
+	result = make_runnable(t);
+	assert(result==0);
+}
+#endif // OPT_A1
+
 
 /*
  * Remove zombies. (Zombies are threads/processes that have exited but not
@@ -123,6 +556,28 @@ static
 void
 thread_killall(void)
 {
+#if OPT_A1
+	int i;
+
+	assert(curspl>0);
+
+	/*
+	 * Empty every wait channel, to be sure nobody wakes up while
+	 * we're shutting down. As below, the threads themselves are
+	 * just dropped on the floor.
+	 */
+
+	for (i=0; i<SLEEPQ_SIZE; i++) {
+		struct wchan *wc;
+		for (wc = sleepq[i]; wc != NULL; wc = wc->wc_next) {
+			struct thread *t;
+			for (t = wc->wc_head; t != NULL; t = t->t_wqnext) {
+				kprintf("sleep: Dropping thread %s\n", t->t_name);
+			}
+		}
+		sleepq[i] = NULL;
+	}
+#else
 	int i, result;
 
 	assert(curspl>0);
@@ -149,6 +604,7 @@ thread_killall(void)
 	result = array_setsize(sleepers, 0);
 	/* shrinking array: not supposed to fail */
 	assert(result==0);
+#endif // OPT_A1
 }
 
 /*
@@ -188,6 +644,11 @@ thread_panic(void)
  */
 int
 one_thread_only() {
+#if OPT_A1
+  /* numthreads is a single word, only ever changed atomically,
+     so a plain load sees a consistent value */
+  return(numthreads==1);
+#else
   int s;
   int n;
   /* numthreads is a shared variable, so turn interrupts
@@ -196,6 +657,7 @@ one_thread_only() {
   n = numthreads;
   splx(s);
   return(n==1);
+#endif // OPT_A1
 }
 
 
@@ -208,10 +670,23 @@ thread_bootstrap(void)
 	struct thread *me;
 
 	/* Create the data structures we need. */
+#if OPT_A1
+	{
+		int i;
+		sleepq = kmalloc(SLEEPQ_SIZE * sizeof(struct wchan *));
+		if (sleepq==NULL) {
+			panic("Cannot create sleep queue table\n");
+		}
+		for (i=0; i<SLEEPQ_SIZE; i++) {
+			sleepq[i] = NULL;
+		}
+	}
+#else
 	sleepers = array_create();
 	if (sleepers==NULL) {
 		panic("Cannot create sleepers array\n");
 	}
+#endif // OPT_A1
 
 	zombies = array_create();
 	if (zombies==NULL) {
@@ -251,8 +726,13 @@ thread_bootstrap(void)
 void
 thread_shutdown(void)
 {
+#if OPT_A1
+	kfree(sleepq);
+	sleepq = NULL;
+#else
 	array_destroy(sleepers);
 	sleepers = NULL;
+#endif // OPT_A1
 	array_destroy(zombies);
 	zombies = NULL;
 	// Don't do this - it frees our stack and we blow up
@@ -260,18 +740,18 @@ thread_shutdown(void)
 }
 
 /*
- * Create a new thread based on an existing one.
- * The new thread has name NAME, and starts executing in function FUNC.
- * DATA1 and DATA2 are passed to FUNC.
+ * Allocate and set up a new thread that will start executing in FUNC,
+ * but don't make it runnable yet. Used by thread_fork and
+ * thread_fork_many.
  */
+static
 int
-thread_fork(const char *name, 
-	    void *data1, unsigned long data2,
-	    void (*func)(void *, unsigned long),
-	    struct thread **ret)
+thread_prepare(const char *name,
+	       void *data1, unsigned long data2,
+	       void (*func)(void *, unsigned long),
+	       struct thread **ret)
 {
 	struct thread *newguy;
-	int s, result;
 
 	/* Allocate a thread */
 	newguy = thread_create(name);
@@ -280,12 +760,23 @@ thread_fork(const char *name,
 	}
 
 	/* Allocate a stack */
+#if OPT_A1
+	/* A recycled thread still has its old stack. */
+	if (newguy->t_stack==NULL) {
+		newguy->t_stack = kmalloc(STACK_SIZE);
+		if (newguy->t_stack==NULL) {
+			thread_destroy(newguy);
+			return ENOMEM;
+		}
+	}
+#else
 	newguy->t_stack = kmalloc(STACK_SIZE);
 	if (newguy->t_stack==NULL) {
 		kfree(newguy->t_name);
 		kfree(newguy);
 		return ENOMEM;
 	}
+#endif // OPT_A1
 
 	/* stick a magic number on the bottom end of the stack */
 	newguy->t_stack[0] = 0xae;
@@ -298,10 +789,48 @@ thread_fork(const char *name,
 		VOP_INCREF(curthread->t_cwd);
 		newguy->t_cwd = curthread->t_cwd;
 	}
+#if OPT_A2
+	/* And the process */
+	newguy->t_proc = curthread->t_proc;
+#endif // OPT_A2
 
 	/* Set up the pcb (this arranges for func to be called) */
 	md_initpcb(&newguy->t_pcb, newguy->t_stack, data1, data2, func);
 
+	*ret = newguy;
+	return 0;
+}
+
+/*
+ * Throw away a thread from thread_prepare that never got to run.
+ */
+static
+void
+thread_unprepare(struct thread *newguy)
+{
+	if (newguy->t_cwd != NULL) {
+		VOP_DECREF(newguy->t_cwd);
+	}
+#if OPT_A1
+	newguy->t_cwd = NULL;
+	thread_destroy(newguy);
+#else
+	kfree(newguy->t_stack);
+	kfree(newguy->t_name);
+	kfree(newguy);
+#endif // OPT_A1
+}
+
+/*
+ * Make N prepared threads runnable, all in one interrupts-off section.
+ * On failure none of them have been made runnable.
+ */
+static
+int
+thread_publish(struct thread **newguys, int n)
+{
+	int i, s, result;
+
 	/* Interrupts off for atomicity */
 	s = splhigh();
 
@@ -309,25 +838,40 @@ thread_fork(const char *name,
 	 * Make sure our data structures have enough space, so we won't
 	 * run out later at an inconvenient time.
 	 */
-	result = array_preallocate(sleepers, numthreads+1);
+#if !OPT_A1
+	/* With wait channels, sleeping needs no preallocated space. */
+	result = array_preallocate(sleepers, numthreads+n);
 	if (result) {
 		goto fail;
 	}
-	result = array_preallocate(zombies, numthreads+1);
+#endif // OPT_A1
+	result = array_preallocate(zombies, numthreads+n);
 	if (result) {
 		goto fail;
 	}
 
 	/* Do the same for the scheduler. */
-	result = scheduler_preallocate(numthreads+1);
+	result = scheduler_preallocate(numthreads+n);
 	if (result) {
 		goto fail;
 	}
 
-	/* Make the new thread runnable */
-	result = make_runnable(newguy);
-	if (result != 0) {
-		goto fail;
+	/* Make the new threads runnable */
+	if (n == 1) {
+		result = make_runnable(newguys[0]);
+		if (result != 0) {
+			goto fail;
+		}
+	}
+	else {
+		for (i=0; i<n; i++) {
+			/*
+			 * We can't back out part way through a batch, but
+			 * with the scheduler preallocated this can't fail.
+			 */
+			result = make_runnable(newguys[i]);
+			assert(result==0);
+		}
 	}
 
 	/*
@@ -336,10 +880,45 @@ thread_fork(const char *name,
 	 * temporarily too low, which would obviate its reason for
 	 * existence.
 	 */
-	numthreads++;
+#if OPT_A1
+	atomic_add_32(&numthreads, n);
+#else
+	numthreads += n;
+#endif // OPT_A1
 
 	/* Done with stuff that needs to be atomic */
 	splx(s);
+	return 0;
+
+ fail:
+	splx(s);
+	return result;
+}
+
+/*
+ * Create a new thread based on an existing one.
+ * The new thread has name NAME, and starts executing in function FUNC.
+ * DATA1 and DATA2 are passed to FUNC.
+ */
+int
+thread_fork(const char *name, 
+	    void *data1, unsigned long data2,
+	    void (*func)(void *, unsigned long),
+	    struct thread **ret)
+{
+	struct thread *newguy;
+	int result;
+
+	result = thread_prepare(name, data1, data2, func, &newguy);
+	if (result) {
+		return result;
+	}
+
+	result = thread_publish(&newguy, 1);
+	if (result) {
+		thread_unprepare(newguy);
+		return result;
+	}
 
 	/*
 	 * Return new thread structure if it's wanted.  Note that
@@ -352,18 +931,102 @@ thread_fork(const char *name,
 	}
 
 	return 0;
+}
 
- fail:
-	splx(s);
-	if (newguy->t_cwd != NULL) {
-		VOP_DECREF(newguy->t_cwd);
+#if OPT_A1
+/*
+ * Like thread_fork, but the new thread is joinable: it is not destroyed
+ * when it exits, but kept until somebody collects it (and its exit
+ * value) with thread_join. RET must not be NULL.
+ */
+int
+thread_fork_joinable(const char *name,
+		     void *data1, unsigned long data2,
+		     void (*func)(void *, unsigned long),
+		     struct thread **ret)
+{
+	struct thread *newguy;
+	int result;
+
+	assert(ret != NULL);
+
+	result = thread_prepare(name, data1, data2, func, &newguy);
+	if (result) {
+		return result;
 	}
-	kfree(newguy->t_stack);
-	kfree(newguy->t_name);
-	kfree(newguy);
+	newguy->t_joinable = 1;
+
+	result = thread_publish(&newguy, 1);
+	if (result) {
+		thread_unprepare(newguy);
+		return result;
+	}
+
+	*ret = newguy;
+	return 0;
+}
+
+/*
+ * Create N new threads, all named NAME and all starting in FUNC. Thread
+ * i gets DATA1 and i as its arguments. Everything is allocated up front
+ * and the whole batch is made runnable in a single interrupts-off
+ * section, so either all N threads are started or none are. If JOINABLE
+ * is set the threads are created as by thread_fork_joinable, and RETS
+ * must not be NULL.
+ */
+int
+thread_fork_many(const char *name, int n,
+		 void *data1,
+		 void (*func)(void *, unsigned long),
+		 int joinable,
+		 struct thread **rets)
+{
+	struct thread **newguys;
+	int i, result;
 
+	assert(n >= 0);
+	assert(!joinable || rets != NULL);
+	if (n == 0) {
+		return 0;
+	}
+
+	/* Use the caller's array to hold the batch if there is one. */
+	newguys = rets;
+	if (newguys == NULL) {
+		newguys = kmalloc(n * sizeof(struct thread *));
+		if (newguys == NULL) {
+			return ENOMEM;
+		}
+	}
+
+	for (i=0; i<n; i++) {
+		result = thread_prepare(name, data1, i, func, &newguys[i]);
+		if (result) {
+			goto fail;
+		}
+		newguys[i]->t_joinable = joinable;
+	}
+
+	result = thread_publish(newguys, n);
+	if (result) {
+		goto fail;
+	}
+
+	if (newguys != rets) {
+		kfree(newguys);
+	}
+	return 0;
+
+ fail:
+	while (i-- > 0) {
+		thread_unprepare(newguys[i]);
+	}
+	if (newguys != rets) {
+		kfree(newguys);
+	}
 	return result;
 }
+#endif // OPT_A1
 
 /*
  * High level, machine-independent context switch code.
@@ -412,15 +1075,34 @@ mi_switch(threadstate_t nextstate)
 		result = make_runnable(cur);
 	}
 	else if (nextstate==S_SLEEP) {
+#if OPT_A1
+		/* thread_sleep already put us on our wait channel. */
+		assert(cur->t_sleepchan != NULL);
+		result = 0;
+#else
 		/*
 		 * Because we preallocate sleepers[] during thread_fork,
 		 * this should never fail.
 		 */
 		result = array_add(sleepers, cur);
+#endif // OPT_A1
 	}
 	else {
 		assert(nextstate==S_ZOMB);
+#if OPT_A1
+		/*
+		 * A joinable thread isn't ours to reap; it stays parked
+		 * until thread_join destroys it.
+		 */
+		if (cur->t_joinable) {
+			result = 0;
+		}
+		else {
+			result = array_add(zombies, cur);
+		}
+#else
 		result = array_add(zombies, cur);
+#endif // OPT_A1
 	}
 	assert(result==0);
 
@@ -432,6 +1114,9 @@ mi_switch(threadstate_t nextstate)
 
 	/* update curthread */
 	curthread = next;
+#if OPT_A2
+	curproc = next->t_proc;
+#endif // OPT_A2
 	
 	/* 
 	 * Call the machine-dependent code that actually does the
@@ -454,15 +1139,33 @@ mi_switch(threadstate_t nextstate)
 	}
 }
 
+#if OPT_A1
+/*
+ * Cause the current thread to exit with exit value 0.
+ */
+void
+thread_exit(void)
+{
+	thread_exit_value(0);
+}
+#endif // OPT_A1
+
 /*
  * Cause the current thread to exit.
  *
  * We clean up the parts of the thread structure we don't actually
  * need to run right away. The rest has to wait until thread_destroy
  * gets called from exorcise().
+ *
+ * Under OPT_A1 this is thread_exit_value, and EXITVAL is handed to
+ * whoever joins this thread, if it was created joinable.
  */
 void
+#if OPT_A1
+thread_exit_value(int exitval)
+#else
 thread_exit(void)
+#endif // OPT_A1
 {
 	if (curthread->t_stack != NULL) {
 		/*
@@ -496,12 +1199,69 @@ thread_exit(void)
 	}
 
 	assert(numthreads>0);
+#if OPT_A1
+	atomic_add_32(&numthreads, -1);
+#else
 	numthreads--;
+#endif // OPT_A1
+
+#if OPT_A1
+	/*
+	 * Let a joiner know. It can't actually run until mi_switch has
+	 * taken us off the CPU, since interrupts are off.
+	 */
+	curthread->t_exitval = exitval;
+	curthread->t_exited = 1;
+	if (curthread->t_joinable) {
+		thread_wakeup(&curthread->t_exitval);
+	}
+#endif // OPT_A1
+
 	mi_switch(S_ZOMB);
 
 	panic("Thread came back from the dead!\n");
 }
 
+#if OPT_A1
+/*
+ * Wait for joinable thread T to exit, store its exit value in EXITVAL
+ * (if not NULL), and destroy it. Each joinable thread must be joined
+ * exactly once; T may not be used afterwards.
+ */
+int
+thread_join(struct thread *t, int *exitval)
+{
+	int spl;
+
+	assert(in_interrupt==0);
+
+	if (t == curthread || !t->t_joinable) {
+		return EINVAL;
+	}
+
+	spl = splhigh();
+	while (!t->t_exited) {
+		thread_sleep(&t->t_exitval);
+	}
+	splx(spl);
+
+	/*
+	 * T has been through mi_switch and is parked off every list, so
+	 * nothing else can touch it now.
+	 */
+	if (exitval != NULL) {
+		*exitval = t->t_exitval;
+	}
+	t->t_joinable = 0;
+
+	spl = splhigh();
+	thread_destroy(t);
+	splx(spl);
+
+	return 0;
+}
+#endif // OPT_A1
+
 /*
  * Yield the cpu to another process, but stay runnable.
  */
@@ -511,7 +1271,11 @@ thread_yield(void)
 	int spl = splhigh();
 
 	/* Check sleepers just in case we get here after shutdown */
+#if OPT_A1
+	assert(sleepq != NULL);
+#else
 	assert(sleepers != NULL);
+#endif // OPT_A1
 
 	mi_switch(S_READY);
 	splx(spl);
@@ -535,10 +1299,52 @@ thread_sleep(const void *addr)
 	assert(in_interrupt==0);
 	
 	curthread->t_sleepaddr = addr;
+#if OPT_A1
+	wchan_enqueue(curthread, addr);
+#endif // OPT_A1
+	scheduler_block(curthread);
 	mi_switch(S_SLEEP);
 	curthread->t_sleepaddr = NULL;
 }
 
+#if OPT_A1
+/*
+ * Sleep until the clock tick count reaches WHEN (see clock_ticks()).
+ * Returns at once if that time has already come. The wakeup comes
+ * from the thread's own timeout on the timer wheel, so the cost of
+ * waking is independent of how many other threads are asleep.
+ */
+void
+thread_sleep_until(u_int32_t when)
+{
+	int spl = splhigh();
+
+	while ((int)(when - clock_ticks()) > 0) {
+		timeout_add_at(&curthread->t_timeout, when);
+		thread_sleep(&curthread->t_timeout);
+	}
+	splx(spl);
+}
+
+/*
+ * Like thread_sleep, but give up after NTICKS clock ticks if nobody
+ * has woken us. Returns nonzero if it timed out, in which case we have
+ * already been taken off ADDR's wait channel. Interrupts must be off.
+ */
+int
+thread_sleep_timeout(const void *addr, int nticks)
+{
+	assert(curspl>0);
+
+	curthread->t_timedout = 0;
+	timeout_add(&curthread->t_timeout, nticks);
+	thread_sleep(addr);
+	timeout_del(&curthread->t_timeout);
+
+	return curthread->t_timedout;
+}
+#endif // OPT_A1
+
 /*
  * Wake up one or more threads who are sleeping on "sleep address"
  * ADDR.
@@ -546,6 +1352,40 @@ thread_sleep(const void *addr)
 void
 thread_wakeup(const void *addr)
 {
+#if OPT_A1
+	struct wchan *wc;
+	int result;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	wc = wchan_lookup(addr);
+	if (wc == NULL) {
+		return;
+	}
+
+	/*
+	 * Wake everybody in FIFO order. The channel leaves the table
+	 * when the last sleeper is dequeued, so don't touch wc after.
+	 */
+	while (wc->wc_count > 0) {
+		struct thread *t = wc->wc_head;
+		int last = (wc->wc_count == 1);
+
+		wchan_dequeue(t);
+
+		/*
+		 * Because we preallocate during thread_fork,
+		 * this should never fail.
+		 */
+		result = make_runnable(t);
+		assert(result==0);
+
+		if (last) {
+			break;
+		}
+	}
+#else
 	int i, result;
 	
 	// meant to be called with interrupts off
@@ -571,8 +1411,122 @@ thread_wakeup(const void *addr)
 			assert(result==0);
 		}
 	}
+#endif // OPT_A1
 }
 
+#if OPT_A1
+/*
+ * Wake up only the thread that has been sleeping on "sleep address"
+ * ADDR the longest. Returns that thread, or NULL if there was nobody
+ * to wake. The caller may use the returned thread to hand it a
+ * resource directly, before it gets a chance to run.
+ */
+struct thread *
+thread_wakeup_one(const void *addr)
+{
+	struct wchan *wc;
+	struct thread *t;
+	int result;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	wc = wchan_lookup(addr);
+	if (wc == NULL) {
+		return NULL;
+	}
+
+	t = wc->wc_head;
+	wchan_dequeue(t);
+
+	/*
+	 * Because we preallocate during thread_fork,
+	 * this should never fail.
+	 */
+	result = make_runnable(t);
+	assert(result==0);
+
+	return t;
+}
+#endif // OPT_A1
+
+#if OPT_A1 && OPT_MLFQ
+/*
+ * Like thread_wakeup_one(), but wake the sleeper on ADDR with the best
+ * effective priority (the longest sleeping of those, if there's a tie).
+ * Looks at every sleeper on ADDR. Used to hand a lock to the waiter that
+ * priority inheritance has been running its owner on behalf of.
+ */
+struct thread *
+thread_wakeup_top(const void *addr)
+{
+	struct wchan *wc;
+	struct thread *t, *best;
+	int result;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	wc = wchan_lookup(addr);
+	if (wc == NULL) {
+		return NULL;
+	}
+
+	best = wc->wc_head;
+	for (t = best->t_wqnext; t != NULL; t = t->t_wqnext) {
+		if (scheduler_priority(t) < scheduler_priority(best)) {
+			best = t;
+		}
+	}
+	wchan_dequeue(best);
+
+	result = make_runnable(best);
+	assert(result==0);
+
+	return best;
+}
+
+/*
+ * Best (numerically lowest) effective priority among the threads
+ * sleeping on ADDR, or PRI_NONE if there are none. Used to work out
+ * priority inheritance through locks.
+ */
+int
+thread_sleepers_toppri(const void *addr)
+{
+	struct wchan *wc;
+	struct thread *t;
+	int best = PRI_NONE;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	wc = wchan_lookup(addr);
+	if (wc == NULL) {
+		return PRI_NONE;
+	}
+	for (t = wc->wc_head; t != NULL; t = t->t_wqnext) {
+		int pri = scheduler_priority(t);
+		if (pri < best) {
+			best = pri;
+		}
+	}
+	return best;
+}
+#endif // OPT_A1 && OPT_MLFQ
+
+#if OPT_A1
+/*
+ * Return nonzero if thread T is running on a processor right now. There
+ * is only one processor, so that can only be the current thread.
+ */
+int
+thread_oncpu(const struct thread *t)
+{
+	return t == curthread;
+}
+#endif // OPT_A1
+
 /*
  * Return nonzero if there are any threads who are sleeping on "sleep address"
  * ADDR. This is meant to be used only for diagnostic purposes.
@@ -580,6 +1534,16 @@ thread_wakeup(const void *addr)
 int
 thread_hassleepers(const void *addr)
 {
+#if OPT_A1
+	struct wchan *wc;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	/* The channel keeps its own count, so this is just the lookup. */
+	wc = wchan_lookup(addr);
+	return wc != NULL ? wc->wc_count : 0;
+#else
 	int i;
 	
 	// meant to be called with interrupts off
@@ -592,6 +1556,7 @@ thread_hassleepers(const void *addr)
 		}
 	}
 	return 0;
+#endif // OPT_A1
 }
 
 /*
@@ -0,0 +1,268 @@
+/*
+ * Kernel timeouts.
+ *
+ * Pending timeouts live on a hierarchical timer wheel: four levels of
+ * 64 slots each. Level 0 holds timeouts due within the next 64 ticks,
+ * one slot per tick; level 1 holds the next 64*64 ticks, one slot per
+ * 64 ticks; and so on. Every 64 ticks the next level 1 slot is
+ * "cascaded" down into level 0 (and likewise up the levels), so each
+ * timeout is moved at most three times however long it waits.
+ *
+ * Each tick then only looks at a single level 0 slot, and everything
+ * in it is due, so the per-tick cost is the number of timeouts expiring
+ * (plus the amortized cascading), independent of how many are pending.
+ * Slots are doubly linked so cancelling a timeout is O(1).
+ *
+ * Timeouts further out than the wheel reaches (about 2^24 ticks) are
+ * parked in the farthest slot and re-filed when it cascades.
+ */
+
+#include <types.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <clock.h>
+#include <seqlock.h>
+#include <timeout.h>
+
+#define WHEEL_BITS	6
+#define WHEEL_SIZE	(1 << WHEEL_BITS)
+#define WHEEL_MASK	(WHEEL_SIZE - 1)
+#define WHEEL_LEVELS	4
+
+/* Farthest ahead the wheel can file a timeout. */
+#define WHEEL_MAXDELTA	((1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+/* Slot of tick count T at wheel level L */
+#define WHEEL_SLOT(t, l)	(((t) >> ((l) * WHEEL_BITS)) & WHEEL_MASK)
+
+static struct timeout *wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Ticks since boot */
+static volatile u_int32_t ticks;
+
+/* Uptime as whole seconds plus ticks into the current second */
+static u_int32_t uptime_secs;
+static u_int32_t uptime_ticks;
+static struct seqlock uptime_seq = SEQLOCK_INITIALIZER;
+
+/* Next tick the wheel has to process; trails ticks only inside timeout_tick */
+static u_int32_t wheel_now;
+
+/*
+ * Put TO in the right slot for its expiry time, relative to wheel_now.
+ * Interrupts must be off.
+ */
+static
+void
+wheel_insert(struct timeout *to)
+{
+	u_int32_t delta = to->to_time - wheel_now;
+	u_int32_t when = to->to_time;
+	struct timeout **slot;
+	int level;
+
+	if ((int)delta < 0) {
+		/* Already due; make it the very next thing to run. */
+		delta = 0;
+		when = wheel_now;
+	}
+	else if (delta > WHEEL_MAXDELTA) {
+		/* Park it as far out as we can; it'll be re-filed later. */
+		delta = WHEEL_MAXDELTA;
+		when = wheel_now + WHEEL_MAXDELTA;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS-1; level++) {
+		if (delta < (1U << ((level+1) * WHEEL_BITS))) {
+			break;
+		}
+	}
+
+	slot = &wheel[level][WHEEL_SLOT(when, level)];
+	to->to_next = *slot;
+	if (*slot != NULL) {
+		(*slot)->to_pprev = &to->to_next;
+	}
+	to->to_pprev = slot;
+	*slot = to;
+}
+
+/*
+ * Take TO off the wheel. Interrupts must be off.
+ */
+static
+void
+wheel_remove(struct timeout *to)
+{
+	*to->to_pprev = to->to_next;
+	if (to->to_next != NULL) {
+		to->to_next->to_pprev = to->to_pprev;
+	}
+	to->to_next = NULL;
+	to->to_pprev = NULL;
+}
+
+/*
+ * Empty slot INDEX of wheel level LEVEL, re-filing everything in it
+ * against the current time. Returns INDEX, so the caller can tell
+ * whether this level just wrapped too.
+ */
+static
+int
+wheel_cascade(int level, int index)
+{
+	struct timeout *to = wheel[level][index];
+
+	wheel[level][index] = NULL;
+	while (to != NULL) {
+		struct timeout *next = to->to_next;
+		wheel_insert(to);
+		to = next;
+	}
+	return index;
+}
+
+void
+timeout_set(struct timeout *to, void (*func)(void *), void *arg)
+{
+	to->to_next = NULL;
+	to->to_pprev = NULL;
+	to->to_time = 0;
+	to->to_func = func;
+	to->to_arg = arg;
+}
+
+void
+timeout_add_at(struct timeout *to, u_int32_t when)
+{
+	int spl = splhigh();
+
+	if (to->to_pprev != NULL) {
+		wheel_remove(to);
+	}
+	if ((int)(when - ticks) <= 0) {
+		when = ticks + 1;
+	}
+	to->to_time = when;
+	wheel_insert(to);
+
+	splx(spl);
+}
+
+void
+timeout_add(struct timeout *to, int nticks)
+{
+	if (nticks < 1) {
+		nticks = 1;
+	}
+	timeout_add_at(to, ticks + nticks);
+}
+
+int
+timeout_del(struct timeout *to)
+{
+	int spl, pending;
+
+	spl = splhigh();
+	pending = (to->to_pprev != NULL);
+	if (pending) {
+		wheel_remove(to);
+	}
+	splx(spl);
+
+	return pending;
+}
+
+int
+timeout_pending(struct timeout *to)
+{
+	return to->to_pprev != NULL;
+}
+
+u_int32_t
+clock_ticks(void)
+{
+	return ticks;
+}
+
+/*
+ * Read the uptime. Never turns interrupts off; retries instead if a
+ * clock tick lands in the middle.
+ */
+void
+clock_uptime(u_int32_t *secs, u_int32_t *nticks)
+{
+	unsigned seq;
+
+	do {
+		seq = seq_readbegin(&uptime_seq);
+		*secs = uptime_secs;
+		*nticks = uptime_ticks;
+	} while (seq_readretry(&uptime_seq, seq));
+}
+
+/*
+ * The uptime read the way it was before the seqlock, with interrupts
+ * off, and a write that leaves it as it was. Only for uptimebench, to
+ * compare clock_uptime() with and to race it against.
+ */
+void
+clock_uptime_spl(u_int32_t *secs, u_int32_t *nticks)
+{
+	int spl = splhigh();
+
+	*secs = uptime_secs;
+	*nticks = uptime_ticks;
+	splx(spl);
+}
+
+void
+clock_uptime_touch(void)
+{
+	int spl = splhigh();
+
+	seq_writebegin(&uptime_seq);
+	seq_writeend(&uptime_seq);
+	splx(spl);
+}
+
+/*
+ * Called from hardclock() HZ times a second, with interrupts off.
+ */
+void
+timeout_tick(void)
+{
+	assert(curspl>0);
+
+	seq_writebegin(&uptime_seq);
+	ticks++;
+	uptime_ticks++;
+	if (uptime_ticks >= HZ) {
+		uptime_ticks = 0;
+		uptime_secs++;
+	}
+	seq_writeend(&uptime_seq);
+
+	while ((int)(ticks - wheel_now) >= 0) {
+		int index = WHEEL_SLOT(wheel_now, 0);
+		struct timeout *to;
+
+		/* Pull the next stretch of time down from the upper levels. */
+		if (index == 0 &&
+		    wheel_cascade(1, WHEEL_SLOT(wheel_now, 1)) == 0 &&
+		    wheel_cascade(2, WHEEL_SLOT(wheel_now, 2)) == 0) {
+			wheel_cascade(3, WHEEL_SLOT(wheel_now, 3));
+		}
+
+		/*
+		 * Everything in this slot is due. Unlink each timeout
+		 * before calling it, so it may re-arm itself.
+		 */
+		while ((to = wheel[0][index]) != NULL) {
+			wheel_remove(to);
+			to->to_func(to->to_arg);
+		}
+
+		wheel_now++;
+	}
+}
@@ -0,0 +1,149 @@
+/*
+ * Futexes: the kernel half of user-level locks.
+ *
+ * A user-level mutex or condition variable does its uncontended work with
+ * atomic instructions on a word in user memory, and only calls in here to
+ * sleep when it has to wait, or to wake a waiter up.
+ *
+ *     futex_wait(uaddr, expected): sleep if the word at uaddr still holds
+ *         expected (checked atomically with going to sleep), else return
+ *         EAGAIN at once.
+ *     futex_wake(uaddr, n): wake up to n threads sleeping on uaddr, and
+ *         return how many were woken.
+ *
+ * Waiters are kept on a hash table keyed by the word. Ideally the key
+ * would be the physical address, so processes sharing memory could share
+ * a futex, but this kernel has no sharing and no page table to look it
+ * up in. So the key is (address space, user address) instead, which is
+ * exactly as unique.
+ */
+
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <thread.h>
+#include <curthread.h>
+#include <syscall.h>
+
+// Number of hash buckets. Must be a power of 2.
+#define FUTEX_HASHSIZE 64
+
+#define FUTEX_HASH(as, uaddr) \
+    ((((u_int32_t)(as) >> 4) ^ ((u_int32_t)(uaddr) >> 2)) & (FUTEX_HASHSIZE-1))
+
+/*
+ * A thread waiting in futex_wait(). Lives on the waiting thread's own
+ * stack, and doubles as its sleep address.
+ */
+struct futex_waiter {
+    struct addrspace *fw_as;
+    userptr_t fw_uaddr;
+    struct thread *fw_thread;
+    volatile int fw_woken;
+    struct futex_waiter *fw_next;   // in the bucket, oldest first
+};
+
+static struct futex_waiter *futex_hash[FUTEX_HASHSIZE];
+
+int
+sys_futex_wait(userptr_t uaddr, int expected)
+{
+    struct futex_waiter w, **pp;
+    int spl, val, err;
+
+    if ((u_int32_t)uaddr & (sizeof(int)-1)) {
+        return EINVAL;
+    }
+
+    w.fw_as = curthread->t_vmspace;
+    w.fw_uaddr = uaddr;
+    w.fw_thread = curthread;
+    w.fw_woken = 0;
+    w.fw_next = NULL;
+
+    /*
+     * Read the word once with interrupts on first. That is where a bad
+     * address is caught, and it brings the page in if need be.
+     */
+    err = copyin((const_userptr_t)uaddr, &val, sizeof(int));
+    if (err) {
+        return err;
+    }
+    if (val != expected) {
+        return EAGAIN;
+    }
+
+    /*
+     * Check the word again and go to sleep with interrupts off, so no
+     * futex_wake() can get in between and be missed. The page was there
+     * a moment ago, so the most this copyin can take is a TLB miss, which
+     * vm_fault() handles without sleeping. Should it fail anyway, the
+     * pcb's bad-fault handler still gets copyin() to return the error,
+     * and we put interrupts back before passing it on.
+     */
+    spl = splhigh();
+
+    err = copyin((const_userptr_t)uaddr, &val, sizeof(int));
+    if (err) {
+        splx(spl);
+        return err;
+    }
+    if (val != expected) {
+        // Changed already; the caller should go and look again
+        splx(spl);
+        return EAGAIN;
+    }
+
+    // Join the end of the queue
+    for (pp = &futex_hash[FUTEX_HASH(w.fw_as, uaddr)]; *pp != NULL;
+         pp = &(*pp)->fw_next) {
+        // nothing
+    }
+    *pp = &w;
+
+    while (!w.fw_woken) {
+        thread_sleep(&w);
+    }
+
+    splx(spl);
+    return 0;
+}
+
+int
+sys_futex_wake(userptr_t uaddr, int n, int32_t *retval)
+{
+    struct addrspace *as = curthread->t_vmspace;
+    struct futex_waiter **pp;
+    int spl, woken = 0;
+
+    if ((u_int32_t)uaddr & (sizeof(int)-1)) {
+        return EINVAL;
+    }
+    if (n < 0) {
+        return EINVAL;
+    }
+
+    spl = splhigh();
+
+    pp = &futex_hash[FUTEX_HASH(as, uaddr)];
+    while (*pp != NULL && woken < n) {
+        struct futex_waiter *w = *pp;
+
+        if (w->fw_as != as || w->fw_uaddr != uaddr) {
+            pp = &w->fw_next;
+            continue;
+        }
+
+        // Unlink before waking; w is gone once its thread runs
+        *pp = w->fw_next;
+        w->fw_woken = 1;
+        thread_wakeup(w);
+        woken++;
+    }
+
+    splx(spl);
+
+    *retval = woken;
+    return 0;
+}
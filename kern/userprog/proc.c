@@ -4,11 +4,21 @@
 
 #include <types.h>
 #include <kern/errno.h>
+#include <kern/limits.h>
+#include <kern/unistd.h>
 #include <lib.h>
+#include <machine/pcb.h>
+#include <machine/spl.h>
 #include <machine/trapframe.h>
-#include <array.h>
+#include <addrspace.h>
+#include <synch.h>
 #include <thread.h>
+#include <curthread.h>
+#include <vfs.h>
 #include <proc.h>
+#include <syscall.h>
+
+#include "opt-A2.h"
 
 /* Global variable for the process currently active at any given time. */
 struct process *curproc;
@@ -18,97 +28,279 @@ static struct proc_table *proc_table;
 
 /*
  * Process Table usage
+ *
+ * Processes are found by pid through a hash table of PROC_HASHSIZE
+ * chains, linked through p_hashnext. Pids are handed out more or less
+ * in order, so consecutive pids land in consecutive buckets and the
+ * chains stay short.
+ *
+ * Pids are handed out from a bitmap, one bit per pid, set while the pid
+ * is in use. A second, summary bitmap has a bit per word of the first,
+ * set while that word is full. The search starts at nextpid, just past
+ * the last pid given out: it looks at the rest of that word, then goes
+ * through the summary for the next word with a free pid. It reads at
+ * most PID_SUMS+1 summary words and two pid words, never a run of full
+ * words one at a time. That is not O(1): there is a summary word per
+ * 1024 pids, so it still grows with PROC_PIDMAX, but at 4096 pids it is
+ * 5 summary words at worst. Because the starting point only moves
+ * forward, a pid that was just freed is not used again until every pid
+ * after it has had a turn.
+ *
+ * The bitmaps are our own word arrays rather than lib/bitmap.c, which
+ * works a byte at a time and doesn't say how its data is laid out.
+ *
+ * Everything here is done with interrupts off.
+ */
+
+#define PID_WORDBITS 32
+#define PID_WORDS    PROC_PIDWORDS
+#define PID_SUMS     PROC_PIDSUMS
+#define PID_ALLSET   0xffffffff
+
+#define PROC_HASH(pid)  ((pid) & (PROC_HASHSIZE - 1))
+
+/*
+ * Lowest clear bit of WORD at or above bit FROM, or -1 if there is none.
+ */
+static
+int
+first_clear(u_int32_t word, u_int32_t from)
+{
+    u_int32_t free = ~word & (PID_ALLSET << from);
+    int bit = 0;
+
+    if (free == 0) {
+        return -1;
+    }
+    while ((free & 1) == 0) {
+        free >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+static
+void
+pid_mark(pid_t pid)
+{
+    u_int32_t w = pid / PID_WORDBITS;
+
+    assert((proc_table->pid_map[w] & (1U << (pid % PID_WORDBITS))) == 0);
+    proc_table->pid_map[w] |= 1U << (pid % PID_WORDBITS);
+    if (proc_table->pid_map[w] == PID_ALLSET) {
+        proc_table->pid_full[w / PID_WORDBITS] |= 1U << (w % PID_WORDBITS);
+    }
+}
+
+static
+void
+pid_unmark(pid_t pid)
+{
+    u_int32_t w = pid / PID_WORDBITS;
+
+    assert((proc_table->pid_map[w] & (1U << (pid % PID_WORDBITS))) != 0);
+    proc_table->pid_map[w] &= ~(1U << (pid % PID_WORDBITS));
+    proc_table->pid_full[w / PID_WORDBITS] &= ~(1U << (w % PID_WORDBITS));
+}
+
+/*
+ * Find a free pid at or after nextpid (wrapping around), or return -1
+ * if there are none. Interrupts must be off.
  */
 static
 pid_t
-request_pid(struct process *p) {
-    int err;
-    pid_t ret;
+find_free_pid(void)
+{
+    u_int32_t w = proc_table->nextpid / PID_WORDBITS;
+    u_int32_t sum, i;
+    int bit;
+
+    // The rest of the word nextpid is in
+    bit = first_clear(proc_table->pid_map[w], proc_table->nextpid % PID_WORDBITS);
+    if (bit >= 0) {
+        return w * PID_WORDBITS + bit;
+    }
 
     /*
-     * First check if we are at the point of re-using pids or not
+     * Then the first word that isn't full, going round the summary from
+     * the next word. The last step comes back to the summary word we
+     * started in, for the words before ours and the start of our own.
      */
-    if ((u_int32_t)array_getnum(proc_table->proc_list) == proc_table->max_processes) {
-        /*
-         * If here, the process table has reached its maximum size and we will
-         * try to reuse a pid.
-         */
-
-        // Remember where we are starting from
-        pid_t start = proc_table->nextpid;
-
-        // Find the next available pid
-        while (array_getguy(proc_table->proc_list, proc_table->nextpid) != NULL) {
-            proc_table->nextpid = (proc_table->nextpid + 1) % proc_table->max_processes;
-
-            // Check if we've looped around. If so, can't allocate anymore processes
-            if (proc_table->nextpid == start) {
-                /*
-                 * Can't return EAGAIN without it being interpreted as a valid pid. So
-                 * convention is to return -1 in place of EAGAIN, so that it can
-                 * eventually be converted to EAGAIN in mips_syscall().
-                 */
-                return -1;
-            }
+    w = (w + 1) % PID_WORDS;
+    for (i = 0; i <= PID_SUMS; i++) {
+        sum = w / PID_WORDBITS;
+        bit = first_clear(proc_table->pid_full[sum], w % PID_WORDBITS);
+        if (bit >= 0) {
+            w = sum * PID_WORDBITS + bit;
+            return w * PID_WORDBITS + first_clear(proc_table->pid_map[w], 0);
         }
+        w = ((sum + 1) % PID_SUMS) * PID_WORDBITS;
+    }
 
-        /*
-         * If here, the table index proc_table->nextpid is NULL and available.
-         * Set the list's nextpid element to be the new process.
-         */
-        array_setguy(proc_table->proc_list, proc_table->nextpid, p);
-    } else {
-        /*
-         * If here, we haven't wrapped around pids yet and just need to increment
-         */
+    return -1;
+}
 
-        // Attempt to preallocate space for 1 additional process in the table
-        err = array_preallocate(proc_table->proc_list, proc_table->nextpid+1);
+/*
+ * Give P a pid and enter it in the process table. Returns EAGAIN if
+ * there are already max_processes processes, or all pids are in use.
+ */
+static
+int
+request_pid(struct process *p, pid_t *retpid) {
+    int spl;
+    pid_t pid;
+    struct process **bucket;
 
-        /*
-         * Can't return ENOMEM without it being interpreted as a valid pid. So
-         * convention is to return -2 in place of ENOMEM, so that it can
-         * eventually be converted to ENOMEM in mips_syscall().
-         */
-        if (err == ENOMEM) {
-            return -2;
-        }
+    spl = splhigh();
 
-        // Add the new process to the table
-        array_add(proc_table->proc_list, p);
+    if (proc_table->nprocs >= proc_table->max_processes) {
+        splx(spl);
+        return EAGAIN;
     }
 
-    // Ensure the new process has the right index
-    assert(array_getguy(proc_table->proc_list, proc_table->nextpid) == p);
+    pid = find_free_pid();
+    if (pid < 0) {
+        splx(spl);
+        return EAGAIN;
+    }
 
-    // Set the return value
-    ret = proc_table->nextpid;
+    pid_mark(pid);
+    proc_table->nextpid = (pid + 1) % PROC_PIDMAX;
 
     // Set the new pid in the registered process' struct
-    p->p_id = ret;
+    p->p_id = pid;
 
-    // Increment the nextpid counter
-    proc_table->nextpid++;
+    // Add the new process to the table
+    bucket = &proc_table->hash[PROC_HASH(pid)];
+    p->p_hashnext = *bucket;
+    *bucket = p;
+    proc_table->nprocs++;
 
-    return ret;
+    splx(spl);
+
+    *retpid = pid;
+
+    return 0;
 }
 
 static
 struct process *
 remove_pid(pid_t pid) {
-    // Get the process being removed
-    struct process *ret = array_getguy(proc_table->proc_list, pid);
+    int spl;
+    struct process **pp, *ret;
 
-    /*
-     * Don't shrink or change the process table in any way. Just set the
-     * index no longer being used to NULL.
-     */
-    struct process *null = NULL;
-    array_setguy(proc_table->proc_list, pid, null);
+    spl = splhigh();
+
+    // Find the process being removed, and unlink it from its chain
+    for (pp = &proc_table->hash[PROC_HASH(pid)]; *pp != NULL; pp = &(*pp)->p_hashnext) {
+        if ((*pp)->p_id == pid) {
+            break;
+        }
+    }
+    ret = *pp;
+    assert(ret != NULL);
+    *pp = ret->p_hashnext;
+    ret->p_hashnext = NULL;
+
+    // Free up the pid
+    pid_unmark(pid);
+    proc_table->nprocs--;
+
+    splx(spl);
 
     return ret;
 }
 
+/*
+ * Parent/child links
+ *
+ * Each process keeps a list of its children, threaded through their
+ * p_sibling fields. p_sibprev points at whatever points at the process
+ * (the parent's p_children, or the previous sibling's p_sibling), so a
+ * child can unlink itself without searching.
+ */
+
+/*
+ * Make CHILD a child of PARENT. Interrupts must be off.
+ */
+static
+void
+add_child(struct process *parent, struct process *child)
+{
+    child->p_parentp = parent;
+    child->p_parent = parent->p_id;
+
+    child->p_sibling = parent->p_children;
+    if (parent->p_children != NULL) {
+        parent->p_children->p_sibprev = &child->p_sibling;
+    }
+    child->p_sibprev = &parent->p_children;
+    parent->p_children = child;
+}
+
+/*
+ * Take CHILD off its parent's list, leaving it an orphan. Interrupts
+ * must be off.
+ */
+static
+void
+remove_child(struct process *child)
+{
+    if (child->p_parentp == NULL) {
+        return;
+    }
+
+    *child->p_sibprev = child->p_sibling;
+    if (child->p_sibling != NULL) {
+        child->p_sibling->p_sibprev = child->p_sibprev;
+    }
+    child->p_sibling = NULL;
+    child->p_sibprev = NULL;
+    child->p_parentp = NULL;
+    child->p_parent = -1;
+}
+
+/*
+ * Free a zombie (or a process that never ran): take it off its parent's
+ * list and out of the table, and release its pid. Constant time, give
+ * or take the hash chain.
+ */
+static
+void
+reap(struct process *p)
+{
+    int spl;
+
+    spl = splhigh();
+    if (p->p_exited) {
+        assert(proc_table->nzombies > 0);
+        proc_table->nzombies--;
+    }
+    remove_child(p);
+    splx(spl);
+
+    remove_pid(p->p_id);
+    kfree(p);
+}
+
+/*
+ * Initialize the parts of a new process that the table looks after.
+ */
+static
+void
+process_init(struct process *p)
+{
+    p->p_id = p->p_parent = -1;
+    p->p_thread = NULL;
+    p->p_exited = 0;
+    p->p_exitcode = 0;
+    p->p_parentp = NULL;
+    p->p_children = NULL;
+    p->p_sibling = NULL;
+    p->p_sibprev = NULL;
+    p->p_hashnext = NULL;
+}
+
 /*
  * Process initialization.
  */
@@ -116,32 +308,43 @@ struct process *
 process_bootstrap(void)
 {
     struct process *me;
+    pid_t pid;
+    u_int32_t i;
+    int err;
 
     // Create the process table
 	proc_table = kmalloc(sizeof(struct proc_table));
 	if (proc_table == NULL) {
 		panic("Cannot create process table\n");
 	}
-
-    // Create the actual process array list
-    proc_table->proc_list = array_create();
-	if (proc_table->proc_list == NULL) {
-		panic("Cannot create process table\n");
-	}
+    bzero(proc_table->hash, sizeof(proc_table->hash));
+    proc_table->nprocs = 0;
+    proc_table->nzombies = 0;
 
     /*
-     * Calculate the limit on the maximum number of
-     * active processes. Roughly estimate that in a
-     * situation where we have many processes, each
-     * one will have only 1 thread and require space
-     * for the size of its stack. And to be safe,
-     * allow up to 1 half of physical memory to be
-     * used for process stacks.
+     * Default limit on the number of active processes. Roughly estimate
+     * that in a situation where we have many processes, each one will
+     * have only 1 thread and require space for the size of its stack. And
+     * to be safe, allow up to 1 half of physical memory to be used for
+     * process stacks. process_setlimit() can change it later.
      */
     proc_table->max_processes = mips_ramsize() / STACK_SIZE / 2;
+    if (proc_table->max_processes > PROC_PIDMAX) {
+        proc_table->max_processes = PROC_PIDMAX;
+    }
+
+    /*
+     * No pids in use. Summary bits past the last pid word are set, so
+     * they look full and are never picked.
+     */
+    bzero(proc_table->pid_map, sizeof(proc_table->pid_map));
+    bzero(proc_table->pid_full, sizeof(proc_table->pid_full));
+    for (i = PID_WORDS; i < PID_SUMS * PID_WORDBITS; i++) {
+        proc_table->pid_full[i / PID_WORDBITS] |= 1U << (i % PID_WORDBITS);
+    }
 
     // Initialize next available pid of process table
-    proc_table->nextpid = 1;
+    proc_table->nextpid = 0;
 
     /*
      * Done process table creation
@@ -152,15 +355,23 @@ process_bootstrap(void)
     if (me == NULL) {
         panic("Cannot create the first process\n");
     }
+    process_init(me);
 
-    // Set the self and parent pids
-    me->p_id = me->p_parent = 0;
+    // Add to the process table. Being first, it gets pid 0.
+    err = request_pid(me, &pid);
+    if (err) {
+        panic("Cannot create the first process\n");
+    }
+    assert(pid == 0);
+
+    // The first process is its own parent, but not its own child
+    me->p_parent = 0;
 
     // Set up the thread
     me->p_thread = thread_bootstrap();
-
-    // Add to the process table
-    array_add(proc_table->proc_list, me);
+#if OPT_A2
+    me->p_thread->t_proc = me;
+#endif // OPT_A2
 
     // Set curproc
     curproc = me;
@@ -168,91 +379,362 @@ process_bootstrap(void)
     return me;
 }
 
+struct process *
+process_lookup(pid_t pid)
+{
+    int spl;
+    struct process *p;
+
+    if (pid < 0 || pid >= PROC_PIDMAX) {
+        return NULL;
+    }
+
+    spl = splhigh();
+    for (p = proc_table->hash[PROC_HASH(pid)]; p != NULL; p = p->p_hashnext) {
+        if (p->p_id == pid) {
+            break;
+        }
+    }
+    splx(spl);
+
+    return p;
+}
+
 struct process *
 process_getparent(void)
 {
-    pid_t parent_pid = curproc->p_parent;
+    return curproc->p_parentp;
+}
+
+void
+process_reparent(struct process *p, struct process *newparent)
+{
+    int spl;
+    struct process *child;
 
-    return array_getguy(proc_table->proc_list, parent_pid);
+    spl = splhigh();
+    while ((child = p->p_children) != NULL) {
+        remove_child(child);
+        if (newparent != NULL) {
+            add_child(newparent, child);
+            if (child->p_exited) {
+                // In case the new parent is already waiting
+                thread_wakeup(newparent);
+            }
+        }
+        else if (child->p_exited) {
+            // Nobody can collect this one now
+            reap(child);
+        }
+    }
+    splx(spl);
 }
 
-pid_t
-sys_fork(struct trapframe *tf)
+int
+process_setlimit(u_int32_t max)
+{
+    if (max < 1 || max > PROC_PIDMAX) {
+        return EINVAL;
+    }
+
+    // Processes already past the new limit are left alone
+    proc_table->max_processes = max;
+
+    return 0;
+}
+
+u_int32_t
+process_getlimit(void)
+{
+    return proc_table->max_processes;
+}
+
+void
+process_getcounts(u_int32_t *nprocs, u_int32_t *nzombies)
+{
+    int spl;
+
+    spl = splhigh();
+    *nprocs = proc_table->nprocs;
+    *nzombies = proc_table->nzombies;
+    splx(spl);
+}
+
+/*
+ * Menu command. "proclimit" shows the limit and how many processes
+ * there are; "proclimit N" sets the limit first.
+ */
+int
+cmd_proclimit(int nargs, char **args)
+{
+    u_int32_t nprocs, nzombies;
+
+    if (nargs == 2) {
+        if (process_setlimit(atoi(args[1]))) {
+            kprintf("proclimit: the limit must be from 1 to %d\n",
+                    PROC_PIDMAX);
+            return EINVAL;
+        }
+    }
+    else if (nargs != 1) {
+        kprintf("Usage: proclimit [MAX]\n");
+        return EINVAL;
+    }
+
+    process_getcounts(&nprocs, &nzombies);
+    kprintf("proclimit: %u processes (%u zombies), limit %u\n",
+            nprocs, nzombies, process_getlimit());
+    return 0;
+}
+
+#if OPT_A2
+/*
+ * _exit: give up everything but the exit code.
+ *
+ * The address space and the rest of the thread go at once, through
+ * thread_exit(). What stays behind is the struct process, marked as
+ * exited, for the parent to collect with waitpid; the parent sleeps on
+ * its own struct process, so that's what we wake. Our children become
+ * orphans, and any of them that have already exited are freed, since
+ * nobody is left to collect them. If we're an orphan ourselves we're
+ * freed straight away for the same reason.
+ */
+void
+sys__exit(int exitcode)
 {
+    struct process *me = curproc;
+    struct process *parent;
+    int spl;
+
+    /*
+     * The kernel's own process (pid 0) is shared by the menu and every
+     * program run from it, so one of those exiting must not orphan or
+     * reap children the others made. It is never torn down; the thread
+     * just goes.
+     */
+    if (me->p_id != 0) {
+        process_reparent(me, NULL);
+
+        spl = splhigh();
+
+        curthread->t_proc = NULL;
+        curproc = NULL;
+        me->p_thread = NULL;
+
+        parent = me->p_parentp;
+        if (parent == NULL) {
+            reap(me);
+        }
+        else {
+            me->p_exitcode = exitcode;
+            me->p_exited = 1;
+            proc_table->nzombies++;
+            thread_wakeup(parent);
+        }
+
+        splx(spl);
+    }
+
+    thread_exit();
+}
+
+/*
+ * waitpid: wait for child PID to exit (or any child, if PID is -1),
+ * collect its exit code, and free what's left of it.
+ */
+int
+sys_waitpid(pid_t pid, userptr_t status, int options, pid_t *retval)
+{
+    struct process *me = curproc;
     struct process *child;
-    struct thread **t;
-    pid_t ret;
-    int err;
+    int spl, err;
+
+    if (options != 0) {
+        return EINVAL;
+    }
+
+    spl = splhigh();
+    for (;;) {
+        if (pid == -1) {
+            if (me->p_children == NULL) {
+                splx(spl);
+                return ECHILD;
+            }
+            for (child = me->p_children; child != NULL; child = child->p_sibling) {
+                if (child->p_exited) {
+                    break;
+                }
+            }
+        }
+        else {
+            child = process_lookup(pid);
+            if (child == NULL) {
+                splx(spl);
+                return ESRCH;
+            }
+            if (child->p_parentp != me) {
+                splx(spl);
+                return ECHILD;
+            }
+            if (!child->p_exited) {
+                child = NULL;
+            }
+        }
+
+        if (child != NULL) {
+            break;
+        }
+
+        // Our children's _exit() wakes us
+        thread_sleep(me);
+    }
+    splx(spl);
+
+    /*
+     * Nobody else can reap our child, so it's safe to let interrupts
+     * back on. If the status can't be stored, leave the zombie for
+     * another try.
+     */
+    if (status != NULL) {
+        err = copyout(&child->p_exitcode, status, sizeof(int));
+        if (err) {
+            return err;
+        }
+    }
+
+    *retval = child->p_id;
+    reap(child);
+
+    return 0;
+}
+
+int
+process_create(struct process **childp)
+{
+    struct process *child;
+    pid_t pid;
+    int err, spl;
 
     // Allocate the new process
     child = kmalloc(sizeof(struct process));
     if (child == NULL) {
-        /*
-         * Can't return ENOMEM without it being interpreted as a valid pid. So
-         * convention is to return -2 in place of ENOMEM, so that it can
-         * eventually be converted to ENOMEM in mips_syscall().
-         */
-        return -2;
+        return ENOMEM;
     }
+    process_init(child);
 
     /*
      * Get a pid from the process table. If this fails, return the error from
      * the process table.
      */
-    ret = request_pid(child);
-    if (ret < 0) {
+    err = request_pid(child, &pid);
+    if (err) {
         // If request_pid failed, die here.
         kfree(child);
-        return ret;
+        return err;
     }
 
-    kprintf("sys_fork(): Got new pid %d\n", ret);
-
     /*
-     * request_pid() should have set the child's pid, but let's set the child's
-     * parent field.
+     * request_pid() should have set the child's pid, but let's link the child
+     * to its parent.
      */
-    assert(child->p_id == ret);
-    child->p_parent = curproc->p_id;
+    assert(child->p_id == pid);
+    spl = splhigh();
+    add_child(curproc, child);
+    splx(spl);
 
-    /*
-     * At this point, what's left to set up in the new process is the thread.
-     * Let thread_fork() finish most of the job (thread's name, kernel stack,
-     * current directory, pcb). It will set the child thread's pcb such that
-     * the new thread will start in md_threadentry(), which will set up the
-     * last two things, which are the user stack (t_vmspace) and copying the
-     * parent's trapframe into the child's kernel stack.
-     *
-     * So to be clear, these next couple lines is where the parent's role in
-     * forking comes to an end; the child sets up its own user stack and
-     * matching trapframe the first time it is scheduled to run.
-     */
-    const char *name = *curproc->p_thread->t_name+"-child";
-    unsigned long ignored_value = 0;
+    *childp = child;
+    return 0;
+}
 
-    err = thread_fork(name, tf, ignored_value, md_forkentry, t);
-    if (err) {
-        kfree(child);
-        remove_pid(ret);
+void
+process_enter(struct process *p)
+{
+    assert(p->p_thread == NULL);
 
-        // Again, can't return ENOMEM. See above comment.
-		return -2;
+    p->p_thread = curthread;
+    curthread->t_proc = p;
+    curproc = p;
+}
+
+void
+process_undo(struct process *child)
+{
+    int spl;
+
+    assert(child->p_thread == NULL);
+
+    spl = splhigh();
+    remove_child(child);
+    splx(spl);
+
+    remove_pid(child->p_id);
+    kfree(child);
+}
+
+int
+sys_fork(struct trapframe *tf, pid_t *retval)
+{
+    struct process *child;
+    struct fork_args *fa;
+    const char *parent_name;
+    char *name;
+    int err;
+
+    err = process_create(&child);
+    if (err) {
+        return err;
     }
 
-    // Ensure that thread_fork() properly returned us the thread
-    assert(sizeof(**t) == sizeof(struct thread));
+    /*
+     * Copy everything the child needs from us now, while we know we're
+     * still here: the trapframe (which mips_syscall() will change on our
+     * way out) and the address space. The parent may have exited by the
+     * time the child first runs, so the child must never look at it.
+     */
+    fa = kmalloc(sizeof(struct fork_args));
+    if (fa == NULL) {
+        process_undo(child);
+        return ENOMEM;
+    }
+    memcpy(&fa->fa_tf, tf, sizeof(struct trapframe));
+    fa->fa_child = child;
 
-    // Finally attach the copy of the parent thread to the child thread
-    child->p_thread = *t;
+    err = as_copy(curthread->t_vmspace, &fa->fa_as);
+    if (err) {
+        kfree(fa);
+        process_undo(child);
+        return ENOMEM;
+    }
 
-    kprintf("sys_fork(): Child successful so far, has name %s\n", child->p_thread->t_name);
+    parent_name = curthread->t_name;
+    name = kmalloc(strlen(parent_name) + sizeof("-child"));
+    if (name == NULL) {
+        as_destroy(fa->fa_as);
+        kfree(fa);
+        process_undo(child);
+        return ENOMEM;
+    }
+    strcpy(name, parent_name);
+    strcat(name, "-child");
 
     /*
-     * TODO: Should wait here to find out that the child ran properly, and that
-     * it was able to allocate its user stack.
+     * Let thread_fork() do the rest (kernel stack, current directory,
+     * pcb); the new thread starts in md_forkentry(), which owns fa from
+     * then on. thread_fork() makes its own copy of the name. The child
+     * fills in child->p_thread itself, since it may run, and even exit,
+     * before we would get to it.
      */
+    err = thread_fork(name, fa, 0, md_forkentry, NULL);
+    kfree(name);
+    if (err) {
+        as_destroy(fa->fa_as);
+        kfree(fa);
+        process_undo(child);
+        return err;
+    }
 
-    return ret;
+    *retval = child->p_id;
+    return 0;
 
     /*// Allocate the child's thread
     t = kmalloc(sizeof(struct thread));
@@ -358,3 +840,265 @@ sys_fork(struct trapframe *tf)
     // Have the new thread (implementing the new process) run forkentry()
     //md_forkentry(tf);
 }
+
+/*
+ * spawn: start a new process running a program, without first copying
+ * the caller as fork() would. The program's name and arguments are
+ * copied into the kernel here; the child loads the program into a new
+ * address space and copies the arguments out onto its user stack, just
+ * as runprogram() does. We wait until it has done so, so that a program
+ * that can't be loaded is reported to the caller.
+ */
+
+struct spawn_args {
+    char *sa_path;
+    char *sa_buf;               /* the argument strings, packed */
+    char **sa_argv;             /* pointers into sa_buf */
+    int sa_argc;
+    struct semaphore *sa_done;  /* V'd by the child when loaded */
+    int sa_result;              /* 0, or why the child couldn't load */
+};
+
+/* User address of the Ith pointer in the user array UARGV */
+#define SPAWN_ARGP(uargv, i) \
+    ((const_userptr_t)((vaddr_t)(uargv) + (i) * sizeof(userptr_t)))
+
+/*
+ * Copy in the NULL-terminated user array of strings UARGV.
+ */
+static
+int
+spawn_copyargs(userptr_t uargv, struct spawn_args *sa)
+{
+    userptr_t uarg;
+    size_t used, got;
+    int i, err;
+
+    // Count them, so the pointer array can be allocated once
+    for (sa->sa_argc = 0; ; sa->sa_argc++) {
+        if ((sa->sa_argc + 1) * sizeof(userptr_t) > ARG_MAX) {
+            return E2BIG;
+        }
+        err = copyin(SPAWN_ARGP(uargv, sa->sa_argc), &uarg, sizeof(userptr_t));
+        if (err) {
+            return err;
+        }
+        if (uarg == NULL) {
+            break;
+        }
+    }
+
+    sa->sa_argv = kmalloc((sa->sa_argc + 1) * sizeof(char *));
+    sa->sa_buf = kmalloc(ARG_MAX);
+    if (sa->sa_argv == NULL || sa->sa_buf == NULL) {
+        return ENOMEM;
+    }
+
+    used = 0;
+    for (i = 0; i < sa->sa_argc; i++) {
+        err = copyin(SPAWN_ARGP(uargv, i), &uarg, sizeof(userptr_t));
+        if (err) {
+            return err;
+        }
+        err = copyinstr((const_userptr_t)uarg, sa->sa_buf + used,
+                        ARG_MAX - used, &got);
+        if (err == ENAMETOOLONG) {
+            return E2BIG;
+        }
+        if (err) {
+            return err;
+        }
+        sa->sa_argv[i] = sa->sa_buf + used;
+        used += got;
+    }
+    sa->sa_argv[i] = NULL;
+
+    return 0;
+}
+
+/*
+ * Copy the arguments out onto the new user stack below *STACKPTR, and
+ * return where the argv array went. Each of sa_argv's pointers is
+ * replaced with the user address of its string as it goes.
+ */
+static
+int
+spawn_pushargs(struct spawn_args *sa, vaddr_t *stackptr, userptr_t *uargv)
+{
+    vaddr_t sp = *stackptr;
+    size_t len;
+    int i, err;
+
+    for (i = sa->sa_argc - 1; i >= 0; i--) {
+        len = strlen(sa->sa_argv[i]) + 1;
+        sp -= len;
+        err = copyout(sa->sa_argv[i], (userptr_t)sp, len);
+        if (err) {
+            return err;
+        }
+        sa->sa_argv[i] = (char *)sp;
+    }
+
+    // The pointer array, 8-byte aligned like the stack itself
+    sp -= (sa->sa_argc + 1) * sizeof(char *);
+    sp &= ~(vaddr_t)7;
+    err = copyout(sa->sa_argv, (userptr_t)sp, (sa->sa_argc + 1) * sizeof(char *));
+    if (err) {
+        return err;
+    }
+
+    *uargv = (userptr_t)sp;
+    *stackptr = sp;
+    return 0;
+}
+
+/*
+ * Load the program in SA into a new address space for the current
+ * thread. On success, returns what md_usermode() needs.
+ */
+static
+int
+spawn_load(struct spawn_args *sa, vaddr_t *entrypoint, vaddr_t *stackptr,
+           userptr_t *uargv)
+{
+    struct vnode *v;
+    int err;
+
+    err = vfs_open(sa->sa_path, O_RDONLY, &v);
+    if (err) {
+        return err;
+    }
+
+    assert(curthread->t_vmspace == NULL);
+    curthread->t_vmspace = as_create();
+    if (curthread->t_vmspace == NULL) {
+        vfs_close(v);
+        return ENOMEM;
+    }
+    as_activate(curthread->t_vmspace);
+
+    err = load_elf(v, entrypoint);
+    vfs_close(v);
+    if (err) {
+        return err;
+    }
+
+    err = as_define_stack(curthread->t_vmspace, stackptr);
+    if (err) {
+        return err;
+    }
+
+    return spawn_pushargs(sa, stackptr, uargv);
+}
+
+/*
+ * Where the spawned process' thread starts.
+ */
+static
+void
+spawn_entry(void *data, unsigned long child)
+{
+    struct spawn_args *sa = data;
+    struct process *me = (struct process *)child;
+    vaddr_t entrypoint, stackptr;
+    userptr_t uargv;
+    int argc;
+
+    // Move into our own process, as md_forkentry() does
+    process_enter(me);
+
+    sa->sa_result = spawn_load(sa, &entrypoint, &stackptr, &uargv);
+    argc = sa->sa_argc;
+    if (sa->sa_result) {
+        /*
+         * The parent throws our process away once it hears about this,
+         * so stop pointing at it. Exiting destroys the half-built
+         * address space.
+         */
+        me->p_thread = NULL;
+        curthread->t_proc = NULL;
+        curproc = NULL;
+        V(sa->sa_done);
+        thread_exit();
+    }
+
+    // Don't touch sa after this; the parent frees it
+    V(sa->sa_done);
+
+    md_usermode(argc, uargv, stackptr, entrypoint);
+    panic("spawn_entry: md_usermode returned\n");
+}
+
+int
+sys_spawn(userptr_t upath, userptr_t uargv, pid_t *retval)
+{
+    struct spawn_args sa;
+    struct process *child;
+    pid_t pid;
+    int err;
+
+    sa.sa_path = NULL;
+    sa.sa_buf = NULL;
+    sa.sa_argv = NULL;
+    sa.sa_done = NULL;
+
+    sa.sa_path = kmalloc(PATH_MAX);
+    if (sa.sa_path == NULL) {
+        err = ENOMEM;
+        goto done;
+    }
+    err = copyinstr((const_userptr_t)upath, sa.sa_path, PATH_MAX, NULL);
+    if (err) {
+        goto done;
+    }
+
+    err = spawn_copyargs(uargv, &sa);
+    if (err) {
+        goto done;
+    }
+
+    sa.sa_done = sem_create("spawn", 0);
+    if (sa.sa_done == NULL) {
+        err = ENOMEM;
+        goto done;
+    }
+
+    // Make the child process, as sys_fork() does
+    err = process_create(&child);
+    if (err) {
+        goto done;
+    }
+    pid = child->p_id;
+
+    err = thread_fork(sa.sa_path, &sa, (unsigned long)child, spawn_entry, NULL);
+    if (err) {
+        process_undo(child);
+        goto done;
+    }
+
+    // Wait for the program to be loaded (or not)
+    P(sa.sa_done);
+    err = sa.sa_result;
+    if (err) {
+        process_undo(child);
+        goto done;
+    }
+
+    *retval = pid;
+
+ done:
+    if (sa.sa_done != NULL) {
+        sem_destroy(sa.sa_done);
+    }
+    if (sa.sa_argv != NULL) {
+        kfree(sa.sa_argv);
+    }
+    if (sa.sa_buf != NULL) {
+        kfree(sa.sa_buf);
+    }
+    if (sa.sa_path != NULL) {
+        kfree(sa.sa_path);
+    }
+    return err;
+}
+#endif // OPT_A2
@@ -1,6 +1,45 @@
-
 /*
  * Definitions for IN-KERNEL entry points for system call implementations.
  */
 
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <clock.h>
+#include <syscall.h>
+
+#include "opt-A2.h"
+
+#if OPT_A2
+/*
+ * __time: the time of day, as seconds and nanoseconds. Either pointer
+ * may be NULL. The seconds are also the return value.
+ */
+int
+sys___time(userptr_t secsp, userptr_t nsecsp, int32_t *retval)
+{
+    time_t secs;
+    u_int32_t nsecs;
+    unsigned long unsecs;
+    int err;
+
+    gettime(&secs, &nsecs);
+
+    if (secsp != NULL) {
+        err = copyout(&secs, secsp, sizeof(time_t));
+        if (err) {
+            return err;
+        }
+    }
+    if (nsecsp != NULL) {
+        unsecs = nsecs;
+        err = copyout(&unsecs, nsecsp, sizeof(unsigned long));
+        if (err) {
+            return err;
+        }
+    }
 
+    *retval = secs;
+    return 0;
+}
+#endif // OPT_A2
@@ -0,0 +1,175 @@
+/*
+ * User-level mutexes and condition variables, on top of futexes.
+ * See umutex.h.
+ *
+ * The mutex is the classic three-state futex lock: 0 is free, 1 is
+ * locked, and 2 is locked with (possibly) somebody asleep in the kernel.
+ * Only the 2 state ever costs a system call, on either side.
+ */
+
+#include <unistd.h>
+#include <umutex.h>
+
+/* futex_wake count meaning "everybody" */
+#define WAKE_ALL 0x7fffffff
+
+/*
+ * Compare and swap, with the MIPS load-linked/store-conditional pair.
+ * Returns the old value of *p; the store happened iff that equals old.
+ */
+static
+int
+cas(volatile int *p, int old, int new)
+{
+	int prev, tmp;
+
+	__asm volatile(
+		".set push;"
+		".set mips2;"
+		".set noreorder;"
+		"1: ll %0, 0(%2);"
+		"bne %0, %3, 2f;"
+		"move %1, %4;"
+		"sc %1, 0(%2);"
+		"beqz %1, 1b;"
+		"nop;"
+		"sync;"
+		"2: .set pop"
+		: "=&r" (prev), "=&r" (tmp)
+		: "r" (p), "r" (old), "r" (new)
+		: "memory");
+
+	return prev;
+}
+
+/*
+ * Atomically store new in *p and return what was there.
+ */
+static
+int
+swap(volatile int *p, int new)
+{
+	int old;
+
+	do {
+		old = *p;
+	} while (cas(p, old, new) != old);
+
+	return old;
+}
+
+/*
+ * Atomically add d to *p.
+ */
+static
+void
+fetch_add(volatile int *p, int d)
+{
+	int old;
+
+	do {
+		old = *p;
+	} while (cas(p, old, old + d) != old);
+}
+
+void
+umutex_init(struct umutex *m)
+{
+	m->um_state = 0;
+}
+
+void
+umutex_lock(struct umutex *m)
+{
+	int c;
+
+	/* Free: take it, and that's all. */
+	c = cas(&m->um_state, 0, 1);
+	if (c == 0) {
+		return;
+	}
+
+	/*
+	 * Contended. Mark it as having waiters and sleep until we find it
+	 * free. Having been asleep, we can't know if we're the last waiter,
+	 * so we take it in state 2; at worst that costs one extra wakeup.
+	 */
+	if (c != 2) {
+		c = swap(&m->um_state, 2);
+	}
+	while (c != 0) {
+		futex_wait(&m->um_state, 2);
+		c = swap(&m->um_state, 2);
+	}
+}
+
+int
+umutex_trylock(struct umutex *m)
+{
+	return cas(&m->um_state, 0, 1) == 0;
+}
+
+void
+umutex_unlock(struct umutex *m)
+{
+	/* Only bother the kernel if somebody might be asleep. */
+	if (swap(&m->um_state, 0) == 2) {
+		futex_wake(&m->um_state, 1);
+	}
+}
+
+void
+ucond_init(struct ucond *c)
+{
+	c->uc_seq = 0;
+	c->uc_waiters = 0;
+}
+
+void
+ucond_wait(struct ucond *c, struct umutex *m)
+{
+	int seq;
+
+	fetch_add(&c->uc_waiters, 1);
+	seq = c->uc_seq;
+
+	umutex_unlock(m);
+
+	/*
+	 * If a signal comes in between the unlock and here, uc_seq has
+	 * moved on and futex_wait returns straight away.
+	 */
+	futex_wait(&c->uc_seq, seq);
+	fetch_add(&c->uc_waiters, -1);
+
+	umutex_lock(m);
+}
+
+/*
+ * Bump the sequence number, so that a waiter that hasn't got as far as
+ * the kernel yet won't go to sleep, and wake up to N threads - but only
+ * if there are any waiters, so signalling nobody stays in user space.
+ * (A waiter counts itself in before reading uc_seq, so one we miss here
+ * will see the new sequence number.)
+ */
+static
+void
+ucond_wake(struct ucond *c, int n)
+{
+	fetch_add(&c->uc_seq, 1);
+	if (c->uc_waiters > 0) {
+		futex_wake(&c->uc_seq, n);
+	}
+}
+
+void
+ucond_signal(struct ucond *c)
+{
+	ucond_wake(c, 1);
+}
+
+void
+ucond_broadcast(struct ucond *c)
+{
+	ucond_wake(c, WAKE_ALL);
+}
@@ -0,0 +1,91 @@
+/*
+ * umutexbench - uncontended user-level locking against locking that
+ * goes through the kernel.
+ *
+ * Usage: umutexbench [LOOPS]
+ *
+ * First locks and unlocks a umutex LOOPS times (default 10000) with
+ * nobody else about. Each time it checks that the mutex isn't in the
+ * "waiters" state, the only one in which umutex_lock or umutex_unlock
+ * makes a system call. Then it does as many rounds of a lock that
+ * enters the kernel on every lock and unlock, as every lock had to
+ * before futexes (a futex_wake on a word nobody sleeps on stands in
+ * for each call). It prints the system calls each way made, and the
+ * time per round.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <err.h>
+#include <umutex.h>
+
+static struct umutex mutex = UMUTEX_INITIALIZER;
+static volatile int kword;
+
+/*
+ * Microseconds since the time S seconds, NS nanoseconds.
+ */
+static
+unsigned long
+usecs_since(time_t s, unsigned long ns)
+{
+	time_t s2;
+	unsigned long ns2;
+
+	__time(&s2, &ns2);
+	return (s2 - s) * 1000000L + ((long)ns2 - (long)ns) / 1000;
+}
+
+static
+void
+report(const char *what, int loops, int calls, unsigned long usecs)
+{
+	printf("umutexbench: %s: %d rounds, %d system calls, %lu us, "
+	       "%lu.%03lu us each\n", what, loops, calls, usecs,
+	       usecs / loops, (usecs % loops) * 1000 / loops);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int loops = 10000, calls, i;
+	time_t s;
+	unsigned long ns, usecs;
+
+	if (argc > 2) {
+		errx(1, "Usage: umutexbench [LOOPS]");
+	}
+	if (argc == 2) {
+		loops = atoi(argv[1]);
+	}
+	if (loops <= 0) {
+		errx(1, "invalid number of loops");
+	}
+
+	calls = 0;
+	__time(&s, &ns);
+	for (i=0; i<loops; i++) {
+		umutex_lock(&mutex);
+		if (mutex.um_state != 1) {
+			/* umutex_unlock will call futex_wake */
+			calls++;
+		}
+		umutex_unlock(&mutex);
+	}
+	usecs = usecs_since(s, ns);
+	report("umutex", loops, calls, usecs);
+
+	__time(&s, &ns);
+	for (i=0; i<loops; i++) {
+		futex_wake(&kword, 0);		/* lock */
+		futex_wake(&kword, 0);		/* unlock */
+	}
+	usecs = usecs_since(s, ns);
+	report("kernel lock", loops, 2 * loops, usecs);
+
+	if (calls != 0) {
+		errx(1, "uncontended umutex made %d system calls", calls);
+	}
+	return 0;
+}